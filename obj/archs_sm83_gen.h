@@ -0,0 +1,1327 @@
+// generated by archsgen.c, do not edit
+#ifndef ARCHS_SM83_GEN_H_
+#define ARCHS_SM83_GEN_H_
+
+static const struct ulas_mnemonic ULAS_SM83_MNEMONICS[128] = {
+    {"add", {152, 14}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"rls", {10, 1}},
+    {"rr", {269, 8}},
+    {NULL, {0, 0}},
+    {"swap", {237, 8}},
+    {NULL, {0, 0}},
+    {"scf", {6, 1}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"sra", {285, 8}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"cp", {219, 9}},
+    {NULL, {0, 0}},
+    {"pop", {229, 4}},
+    {"ret", {103, 5}},
+    {NULL, {0, 0}},
+    {"set", {429, 64}},
+    {"nop", {0, 1}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"rl", {261, 8}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"daa", {5, 1}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"halt", {1, 1}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"rst", {120, 8}},
+    {"suc", {228, 1}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"sbc", {184, 8}},
+    {NULL, {0, 0}},
+    {"stop", {2, 1}},
+    {"and", {192, 9}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"ldh", {94, 4}},
+    {NULL, {0, 0}},
+    {"rra", {12, 1}},
+    {"sub", {175, 9}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"cpl", {7, 1}},
+    {NULL, {0, 0}},
+    {"rlca", {9, 1}},
+    {"xor", {201, 9}},
+    {"jr", {98, 5}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"or", {210, 9}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"rlc", {245, 8}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"rrca", {11, 1}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"res", {365, 64}},
+    {"call", {115, 5}},
+    {"reti", {108, 1}},
+    {"ei", {4, 1}},
+    {NULL, {0, 0}},
+    {"adc", {166, 9}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"ccf", {8, 1}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"rrc", {253, 8}},
+    {"bit", {301, 64}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"dec", {140, 12}},
+    {"srl", {293, 8}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"sla", {277, 8}},
+    {NULL, {0, 0}},
+    {"inc", {128, 12}},
+    {NULL, {0, 0}},
+    {"di", {3, 1}},
+    {NULL, {0, 0}},
+    {"ld", {13, 81}},
+    {NULL, {0, 0}},
+    {"push", {233, 4}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {"jp", {109, 6}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+    {NULL, {0, 0}},
+};
+
+static const struct ulas_keyword ULAS_SM83_KEYWORDS[128] = {
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {"#define", ULAS_KW_PPDIR, ULAS_PPDIR_DEF},
+    {NULL, ULAS_KW_NONE, 0},
+    {"0x38", ULAS_KW_REG, 24},
+    {"e", ULAS_KW_REG, 4},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {"l", ULAS_KW_REG, 6},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {"0x28", ULAS_KW_REG, 22},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {".db", ULAS_KW_ASMDIR, ULAS_ASMDIR_BYTE},
+    {"d", ULAS_KW_REG, 3},
+    {".def", ULAS_KW_ASMDIR, ULAS_ASMDIR_DEF},
+    {NULL, ULAS_KW_NONE, 0},
+    {"nz", ULAS_KW_REG, 11},
+    {NULL, ULAS_KW_NONE, 0},
+    {"c", ULAS_KW_REG, 2},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {"#ifndef", ULAS_KW_PPDIR, ULAS_PPDIR_IFNDEF},
+    {"0x18", ULAS_KW_REG, 20},
+    {"0x30", ULAS_KW_REG, 23},
+    {".set", ULAS_KW_ASMDIR, ULAS_ASMDIR_SET},
+    {NULL, ULAS_KW_NONE, 0},
+    {"#include", ULAS_KW_PPDIR, ULAS_PPDIR_INCLUDE},
+    {NULL, ULAS_KW_NONE, 0},
+    {".adv", ULAS_KW_ASMDIR, ULAS_ASMDIR_ADV},
+    {".pad", ULAS_KW_ASMDIR, ULAS_ASMDIR_PAD},
+    {"0x10", ULAS_KW_REG, 19},
+    {".de", ULAS_KW_ASMDIR, ULAS_ASMDIR_DEFINE_ENUM},
+    {NULL, ULAS_KW_NONE, 0},
+    {"0x20", ULAS_KW_REG, 21},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {".align", ULAS_KW_ASMDIR, ULAS_ASMDIR_ALIGN},
+    {"hl", ULAS_KW_REG, 10},
+    {NULL, ULAS_KW_NONE, 0},
+    {"bc", ULAS_KW_REG, 8},
+    {".chr", ULAS_KW_ASMDIR, ULAS_ASMDIR_CHR},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {".se", ULAS_KW_ASMDIR, ULAS_ASMDIR_SET_ENUM_DEF},
+    {"sp", ULAS_KW_REG, 15},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {"#macro", ULAS_KW_PPDIR, ULAS_PPDIR_MACRO},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {".str", ULAS_KW_ASMDIR, ULAS_ASMDIR_STR},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {".chksm", ULAS_KW_ASMDIR, ULAS_ASMDIR_CHKSM},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {".rep", ULAS_KW_ASMDIR, ULAS_ASMDIR_REP},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {"z", ULAS_KW_REG, 12},
+    {NULL, ULAS_KW_NONE, 0},
+    {"#undefine", ULAS_KW_PPDIR, ULAS_PPDIR_UNDEF},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {".scc", ULAS_KW_ASMDIR, ULAS_ASMDIR_SETCHRCODE},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {"0x00", ULAS_KW_REG, 17},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {".incbin", ULAS_KW_ASMDIR, ULAS_ASMDIR_INCBIN},
+    {NULL, ULAS_KW_NONE, 0},
+    {"nc", ULAS_KW_REG, 13},
+    {NULL, ULAS_KW_NONE, 0},
+    {"0x08", ULAS_KW_REG, 18},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {"b", ULAS_KW_REG, 1},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {".org", ULAS_KW_ASMDIR, ULAS_ASMDIR_ORG},
+    {NULL, ULAS_KW_NONE, 0},
+    {"#endmacro", ULAS_KW_PPDIR, ULAS_PPDIR_ENDMACRO},
+    {"de", ULAS_KW_REG, 9},
+    {NULL, ULAS_KW_NONE, 0},
+    {"#endif", ULAS_KW_PPDIR, ULAS_PPDIR_ENDIF},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {"a", ULAS_KW_REG, 7},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {".fill", ULAS_KW_ASMDIR, ULAS_ASMDIR_FILL},
+    {"h", ULAS_KW_REG, 5},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {NULL, ULAS_KW_NONE, 0},
+    {"#ifdef", ULAS_KW_PPDIR, ULAS_PPDIR_IFDEF},
+    {"af", ULAS_KW_REG, 16},
+};
+
+static const unsigned int ULAS_SM83_REGS_CANON[25] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 2, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+};
+
+static const unsigned int ULAS_SM83_INSTRS_INDEX[494] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+    32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
+    48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63,
+    64, 65, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76, 77, 78, 79,
+    80, 81, 82, 87, 88, 89, 90, 91, 92, 93, 94, 95, 96, 97, 83, 84,
+    85, 86, 98, 99, 100, 101, 102, 103, 104, 105, 106, 107, 108, 109, 110, 111,
+    112, 113, 114, 115, 116, 117, 118, 119, 120, 121, 122, 123, 124, 125, 126, 127,
+    128, 129, 130, 131, 132, 133, 134, 135, 144, 145, 146, 147, 136, 137, 138, 139,
+    140, 141, 142, 143, 148, 149, 150, 151, 152, 153, 154, 155, 156, 157, 158, 159,
+    216, 224, 225, 226, 227, 228, 160, 161, 162, 163, 164, 165, 166, 167, 220, 168,
+    169, 170, 171, 172, 173, 174, 175, 217, 176, 177, 178, 179, 180, 181, 182, 183,
+    184, 185, 186, 187, 188, 189, 190, 191, 218, 192, 193, 194, 195, 196, 197, 198,
+    199, 222, 200, 201, 202, 203, 204, 205, 206, 207, 219, 208, 209, 210, 211, 212,
+    213, 214, 215, 223, 221, 229, 230, 231, 232, 233, 234, 235, 236, 237, 238, 239,
+    240, 241, 242, 243, 244, 245, 246, 247, 248, 249, 250, 251, 252, 253, 254, 255,
+    256, 257, 258, 259, 260, 261, 262, 263, 264, 265, 266, 267, 268, 269, 270, 271,
+    272, 273, 274, 275, 276, 277, 278, 279, 280, 281, 282, 283, 284, 285, 286, 287,
+    288, 289, 290, 291, 292, 293, 294, 295, 296, 297, 298, 299, 300, 301, 302, 303,
+    304, 305, 306, 307, 308, 309, 310, 311, 312, 313, 314, 315, 316, 317, 318, 319,
+    320, 321, 322, 323, 324, 325, 326, 327, 328, 329, 330, 331, 332, 333, 334, 335,
+    336, 337, 338, 339, 340, 341, 342, 343, 344, 345, 346, 347, 348, 349, 350, 351,
+    352, 353, 354, 355, 356, 357, 358, 359, 360, 361, 362, 363, 364, 365, 366, 367,
+    368, 369, 370, 371, 372, 373, 374, 375, 376, 377, 378, 379, 380, 381, 382, 383,
+    384, 385, 386, 387, 388, 389, 390, 391, 392, 393, 394, 395, 396, 397, 398, 399,
+    400, 401, 402, 403, 404, 405, 406, 407, 408, 409, 410, 411, 412, 413, 414, 415,
+    416, 417, 418, 419, 420, 421, 422, 423, 424, 425, 426, 427, 428, 429, 430, 431,
+    432, 433, 434, 435, 436, 437, 438, 439, 440, 441, 442, 443, 444, 445, 446, 447,
+    448, 449, 450, 451, 452, 453, 454, 455, 456, 457, 458, 459, 460, 461, 462, 463,
+    464, 465, 466, 467, 468, 469, 470, 471, 472, 473, 474, 475, 476, 477, 478, 479,
+    480, 481, 482, 483, 484, 485, 486, 487, 488, 489, 490, 491, 492,
+    0};
+
+static const struct ulas_instrrange ULAS_SM83_DECODE[256] = {
+    {0, 1},
+    {94, 3},
+    {69, 1},
+    {128, 1},
+    {132, 1},
+    {136, 1},
+    {87, 2},
+    {9, 1},
+    {79, 3},
+    {225, 1},
+    {75, 1},
+    {140, 1},
+    {144, 1},
+    {148, 1},
+    {90, 2},
+    {11, 1},
+    {2, 2},
+    {95, 3},
+    {70, 1},
+    {129, 1},
+    {133, 1},
+    {137, 1},
+    {88, 2},
+    {10, 1},
+    {102, 2},
+    {226, 1},
+    {76, 1},
+    {141, 1},
+    {145, 1},
+    {149, 1},
+    {91, 2},
+    {12, 1},
+    {98, 2},
+    {96, 3},
+    {72, 1},
+    {130, 1},
+    {134, 1},
+    {138, 1},
+    {89, 2},
+    {5, 1},
+    {100, 2},
+    {227, 1},
+    {77, 1},
+    {142, 1},
+    {146, 1},
+    {150, 1},
+    {92, 2},
+    {7, 1},
+    {99, 2},
+    {97, 3},
+    {73, 1},
+    {131, 1},
+    {135, 1},
+    {139, 1},
+    {74, 2},
+    {6, 1},
+    {101, 2},
+    {228, 1},
+    {78, 1},
+    {143, 1},
+    {147, 1},
+    {151, 1},
+    {93, 2},
+    {8, 1},
+    {13, 1},
+    {14, 1},
+    {15, 1},
+    {16, 1},
+    {17, 1},
+    {18, 1},
+    {19, 1},
+    {20, 1},
+    {21, 1},
+    {22, 1},
+    {23, 1},
+    {24, 1},
+    {25, 1},
+    {26, 1},
+    {27, 1},
+    {28, 1},
+    {29, 1},
+    {30, 1},
+    {31, 1},
+    {32, 1},
+    {33, 1},
+    {34, 1},
+    {35, 1},
+    {36, 1},
+    {37, 1},
+    {38, 1},
+    {39, 1},
+    {40, 1},
+    {41, 1},
+    {42, 1},
+    {43, 1},
+    {44, 1},
+    {45, 1},
+    {46, 1},
+    {47, 1},
+    {48, 1},
+    {49, 1},
+    {50, 1},
+    {51, 1},
+    {52, 1},
+    {53, 1},
+    {54, 1},
+    {55, 1},
+    {56, 1},
+    {57, 1},
+    {58, 1},
+    {59, 1},
+    {60, 1},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {1, 1},
+    {71, 1},
+    {61, 1},
+    {62, 1},
+    {63, 1},
+    {64, 1},
+    {65, 1},
+    {66, 1},
+    {67, 1},
+    {68, 1},
+    {152, 1},
+    {153, 1},
+    {154, 1},
+    {155, 1},
+    {156, 1},
+    {157, 1},
+    {158, 1},
+    {159, 1},
+    {160, 1},
+    {161, 1},
+    {162, 1},
+    {163, 1},
+    {164, 1},
+    {165, 1},
+    {166, 1},
+    {167, 1},
+    {168, 1},
+    {169, 1},
+    {170, 1},
+    {171, 1},
+    {172, 1},
+    {173, 1},
+    {174, 1},
+    {175, 1},
+    {176, 1},
+    {177, 1},
+    {178, 1},
+    {179, 1},
+    {180, 1},
+    {181, 1},
+    {182, 1},
+    {183, 1},
+    {184, 1},
+    {185, 1},
+    {186, 1},
+    {187, 1},
+    {188, 1},
+    {189, 1},
+    {190, 1},
+    {191, 1},
+    {192, 1},
+    {193, 1},
+    {194, 1},
+    {195, 1},
+    {196, 1},
+    {197, 1},
+    {198, 1},
+    {199, 1},
+    {200, 1},
+    {201, 1},
+    {202, 1},
+    {203, 1},
+    {204, 1},
+    {205, 1},
+    {206, 1},
+    {207, 1},
+    {208, 1},
+    {209, 1},
+    {210, 1},
+    {211, 1},
+    {212, 1},
+    {213, 1},
+    {214, 1},
+    {215, 1},
+    {103, 1},
+    {229, 1},
+    {109, 3},
+    {114, 3},
+    {115, 3},
+    {233, 1},
+    {216, 2},
+    {120, 1},
+    {105, 1},
+    {107, 1},
+    {111, 3},
+    {245, 1},
+    {117, 3},
+    {119, 3},
+    {220, 2},
+    {124, 1},
+    {104, 1},
+    {230, 1},
+    {110, 3},
+    {0, 0},
+    {116, 3},
+    {234, 1},
+    {217, 2},
+    {121, 1},
+    {106, 1},
+    {108, 1},
+    {112, 3},
+    {0, 0},
+    {118, 3},
+    {0, 0},
+    {221, 2},
+    {125, 1},
+    {85, 2},
+    {231, 1},
+    {83, 1},
+    {0, 0},
+    {0, 0},
+    {235, 1},
+    {218, 2},
+    {122, 1},
+    {224, 2},
+    {113, 1},
+    {80, 3},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {222, 2},
+    {126, 1},
+    {86, 2},
+    {232, 1},
+    {84, 1},
+    {3, 1},
+    {0, 0},
+    {236, 1},
+    {219, 2},
+    {123, 1},
+    {82, 2},
+    {0, 0},
+    {81, 3},
+    {4, 1},
+    {0, 0},
+    {0, 0},
+    {223, 2},
+    {127, 1},
+};
+
+static const struct ulas_instrrange ULAS_SM83_DECODE_PREFIXED[256] = {
+    {0, 0},
+    {246, 2},
+    {247, 2},
+    {248, 2},
+    {249, 2},
+    {250, 2},
+    {251, 2},
+    {252, 2},
+    {253, 2},
+    {254, 2},
+    {255, 2},
+    {256, 2},
+    {257, 2},
+    {258, 2},
+    {259, 2},
+    {260, 2},
+    {261, 2},
+    {262, 2},
+    {263, 2},
+    {264, 2},
+    {265, 2},
+    {266, 2},
+    {267, 2},
+    {268, 2},
+    {269, 2},
+    {270, 2},
+    {271, 2},
+    {272, 2},
+    {273, 2},
+    {274, 2},
+    {275, 2},
+    {276, 2},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {0, 0},
+    {237, 2},
+    {238, 2},
+    {239, 2},
+    {240, 2},
+    {241, 2},
+    {242, 2},
+    {243, 2},
+    {244, 2},
+    {293, 2},
+    {294, 2},
+    {295, 2},
+    {296, 2},
+    {297, 2},
+    {298, 2},
+    {299, 2},
+    {300, 2},
+    {301, 2},
+    {302, 2},
+    {303, 2},
+    {304, 2},
+    {305, 2},
+    {306, 2},
+    {307, 2},
+    {308, 2},
+    {309, 2},
+    {310, 2},
+    {311, 2},
+    {312, 2},
+    {313, 2},
+    {314, 2},
+    {315, 2},
+    {316, 2},
+    {317, 2},
+    {318, 2},
+    {319, 2},
+    {320, 2},
+    {321, 2},
+    {322, 2},
+    {323, 2},
+    {324, 2},
+    {325, 2},
+    {326, 2},
+    {327, 2},
+    {328, 2},
+    {329, 2},
+    {330, 2},
+    {331, 2},
+    {332, 2},
+    {333, 2},
+    {334, 2},
+    {335, 2},
+    {336, 2},
+    {337, 2},
+    {338, 2},
+    {339, 2},
+    {340, 2},
+    {341, 2},
+    {342, 2},
+    {343, 2},
+    {344, 2},
+    {345, 2},
+    {346, 2},
+    {347, 2},
+    {348, 2},
+    {349, 2},
+    {350, 2},
+    {351, 2},
+    {352, 2},
+    {353, 2},
+    {354, 2},
+    {355, 2},
+    {356, 2},
+    {357, 2},
+    {358, 2},
+    {359, 2},
+    {360, 2},
+    {361, 2},
+    {362, 2},
+    {363, 2},
+    {364, 2},
+    {365, 2},
+    {366, 2},
+    {367, 2},
+    {368, 2},
+    {369, 2},
+    {370, 2},
+    {371, 2},
+    {372, 2},
+    {373, 2},
+    {374, 2},
+    {375, 2},
+    {376, 2},
+    {377, 2},
+    {378, 2},
+    {379, 2},
+    {380, 2},
+    {381, 2},
+    {382, 2},
+    {383, 2},
+    {384, 2},
+    {385, 2},
+    {386, 2},
+    {387, 2},
+    {388, 2},
+    {389, 2},
+    {390, 2},
+    {391, 2},
+    {392, 2},
+    {393, 2},
+    {394, 2},
+    {395, 2},
+    {396, 2},
+    {397, 2},
+    {398, 2},
+    {399, 2},
+    {400, 2},
+    {401, 2},
+    {402, 2},
+    {403, 2},
+    {404, 2},
+    {405, 2},
+    {406, 2},
+    {407, 2},
+    {408, 2},
+    {409, 2},
+    {410, 2},
+    {411, 2},
+    {412, 2},
+    {413, 2},
+    {414, 2},
+    {415, 2},
+    {416, 2},
+    {417, 2},
+    {418, 2},
+    {419, 2},
+    {420, 2},
+    {421, 2},
+    {422, 2},
+    {423, 2},
+    {424, 2},
+    {425, 2},
+    {426, 2},
+    {427, 2},
+    {428, 2},
+    {429, 2},
+    {430, 2},
+    {431, 2},
+    {432, 2},
+    {433, 2},
+    {434, 2},
+    {435, 2},
+    {436, 2},
+    {437, 2},
+    {438, 2},
+    {439, 2},
+    {440, 2},
+    {441, 2},
+    {442, 2},
+    {443, 2},
+    {444, 2},
+    {445, 2},
+    {446, 2},
+    {447, 2},
+    {448, 2},
+    {449, 2},
+    {450, 2},
+    {451, 2},
+    {452, 2},
+    {453, 2},
+    {454, 2},
+    {455, 2},
+    {456, 2},
+    {457, 2},
+    {458, 2},
+    {459, 2},
+    {460, 2},
+    {461, 2},
+    {462, 2},
+    {463, 2},
+    {464, 2},
+    {465, 2},
+    {466, 2},
+    {467, 2},
+    {468, 2},
+    {469, 2},
+    {470, 2},
+    {471, 2},
+    {472, 2},
+    {473, 2},
+    {474, 2},
+    {475, 2},
+    {476, 2},
+    {477, 2},
+    {478, 2},
+    {479, 2},
+    {480, 2},
+    {481, 2},
+    {482, 2},
+    {483, 2},
+    {484, 2},
+    {485, 2},
+    {486, 2},
+    {487, 2},
+    {488, 2},
+    {489, 2},
+    {490, 2},
+    {491, 2},
+    {492, 2},
+};
+
+static const unsigned char ULAS_SM83_JUMPS[493] = {
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_REL8,
+    ULAS_JUMP_REL8,
+    ULAS_JUMP_REL8,
+    ULAS_JUMP_REL8,
+    ULAS_JUMP_REL8,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_ABS16,
+    ULAS_JUMP_ABS16,
+    ULAS_JUMP_ABS16,
+    ULAS_JUMP_ABS16,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_ABS16,
+    ULAS_JUMP_ABS16,
+    ULAS_JUMP_ABS16,
+    ULAS_JUMP_ABS16,
+    ULAS_JUMP_ABS16,
+    ULAS_JUMP_ABS16,
+    ULAS_JUMP_RST,
+    ULAS_JUMP_RST,
+    ULAS_JUMP_RST,
+    ULAS_JUMP_RST,
+    ULAS_JUMP_RST,
+    ULAS_JUMP_RST,
+    ULAS_JUMP_RST,
+    ULAS_JUMP_RST,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+    ULAS_JUMP_NONE,
+};
+
+static const struct ulas_archtables ULAS_SM83_TABLES = {
+    ULAS_SM83_MNEMONICS, 128, 2166136567u,
+    ULAS_SM83_KEYWORDS, 128, 2166141835u,
+    ULAS_SM83_REGS_CANON,
+    ULAS_SM83_INSTRS_INDEX, 0xCB,
+    ULAS_SM83_DECODE, ULAS_SM83_DECODE_PREFIXED,
+    ULAS_SM83_JUMPS};
+
+#endif
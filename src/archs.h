@@ -68,6 +68,79 @@ enum ulas_asmspetok {
 
 enum ulas_archs { ULAS_ARCH_SM83 };
 
+struct ulas_instrrange {
+  unsigned int start;
+  unsigned int len;
+};
+
+struct ulas_mnemonic {
+  const char *name;
+  struct ulas_instrrange range;
+};
+
+enum ulas_keywordkind {
+  ULAS_KW_NONE,
+  // value is an enum ulas_ppdirs
+  ULAS_KW_PPDIR,
+  // value is an enum ulas_asmdir
+  ULAS_KW_ASMDIR,
+  // value is a register id
+  ULAS_KW_REG
+};
+
+struct ulas_keyword {
+  const char *name;
+  enum ulas_keywordkind kind;
+  int value;
+};
+
+// how an instruction transfers control, used by the disassembler
+// to find jump targets
+enum ulas_jumpkind {
+  ULAS_JUMP_NONE,
+  // signed 8 bit offset from the end of the instruction
+  ULAS_JUMP_REL8,
+  // absolute 16 bit address operand
+  ULAS_JUMP_ABS16,
+  // fixed vector given by the register token
+  ULAS_JUMP_RST
+};
+
+// lookup tables generated at build time by archsgen.c
+struct ulas_archtables {
+  // perfect hash of all mnemonics
+  // the slot of a mnemonic is
+  // ulas_archhash(name, n, mnemonics_seed) & (mnemonics_len - 1)
+  // empty slots have a NULL name
+  const struct ulas_mnemonic *mnemonics;
+  unsigned long mnemonics_len;
+  unsigned int mnemonics_seed;
+
+  // perfect hash of all directives and register names
+  // hashed like the mnemonics
+  const struct ulas_keyword *keywords;
+  unsigned long keywords_len;
+  unsigned int keywords_seed;
+  // register id -> id of the first register with the same name
+  // e.g. the c register and the c (carry) condition
+  const unsigned int *regs_canon;
+
+  // instrs indices grouped by mnemonic
+  // the order of the instruction table is preserved within a mnemonic
+  const unsigned int *instrs_index;
+
+  // opcode byte -> {instrs index, length in bytes}
+  // instructions starting with prefix are found by their second byte
+  // in decode_prefixed instead
+  // a length of 0 marks an unused opcode
+  unsigned int prefix;
+  const struct ulas_instrrange *decode;
+  const struct ulas_instrrange *decode_prefixed;
+
+  // instrs index -> enum ulas_jumpkind
+  const unsigned char *jumps;
+};
+
 struct ulas_arch {
   enum ulas_archs type;
   const char **regs_names;
@@ -75,10 +148,32 @@ struct ulas_arch {
 
   const struct ulas_instr *instrs;
   enum ulas_endianess endianess;
+
+  const struct ulas_archtables *tables;
 };
 
 void ulas_arch_set(enum ulas_archs arch);
 
+// seeded FNV-1a used by the generated mnemonic tables
+unsigned int ulas_archhash(const char *s, unsigned long n, unsigned int seed);
+
+// returns the directive or register named s or NULL
+const struct ulas_keyword *ulas_arch_keyword(const char *s, unsigned long n);
+
+// returns all instrs indices that are candidates for the mnemonic
+// len is set to the amount of candidates
+const unsigned int *ulas_arch_instrs(const char *mnemonic, unsigned long n,
+                                     unsigned long *len);
+
+// returns the instruction whose opcode starts buf
+// start is the instrs index and len the instruction's length in bytes
+// returns NULL if no instruction matches or buf is too short
+const struct ulas_instrrange *ulas_arch_decode(const char *buf,
+                                               unsigned long read);
+
+// returns the jump kind of the instruction at instrs index instr
+enum ulas_jumpkind ulas_arch_jump(unsigned int instr);
+
 // returns how many bytes of an instruction are occupied 
 // by the opcode based on its data 
 unsigned int ulas_arch_opcode_len(const char *buf, unsigned long read);
@@ -0,0 +1,332 @@
+#include "ulas.h"
+#include "archs_sm83.h"
+#include <assert.h>
+
+/**
+ * Generates the lookup tables of an instruction spec as a C header.
+ * The output is included by archs.c:
+ *   - a perfect hash of all mnemonics pointing to their candidates
+ *   - a perfect hash of all directives and register names
+ *   - the instrs indices grouped by mnemonic
+ *   - 256-entry decode tables for opcodes and prefixed opcodes
+ *   - the jump kind of every instruction
+ * usage: archsgen > archs_sm83_gen.h
+ */
+
+#define ARCHSGEN_INSTRSMAX 1024
+#define ARCHSGEN_MNEMONICSMAX 256
+#define ARCHSGEN_KEYWORDSMAX 256
+#define ARCHSGEN_OPCODES 256
+#define ARCHSGEN_PREFIX 0xCB
+#define ARCHSGEN_SEED 2166136261u
+#define ARCHSGEN_SEEDTRIES 1000000
+#define ARCHSGEN_HASHMAX 1024
+
+struct archsgen_mnemonic {
+  const char *name;
+  unsigned int start;
+  unsigned int len;
+};
+
+struct archsgen_keyword {
+  const char *name;
+  const char *kind;
+  const char *value;
+};
+
+#define ARCHSGEN_PPDIR(name, value) {(name), "ULAS_KW_PPDIR", #value}
+#define ARCHSGEN_ASMDIR(name, value) {(name), "ULAS_KW_ASMDIR", #value}
+
+// all directives, the registers are added from the spec
+static const struct archsgen_keyword ARCHSGEN_DIRS[] = {
+    ARCHSGEN_PPDIR(ULAS_PPSTR_DEF, ULAS_PPDIR_DEF),
+    ARCHSGEN_PPDIR(ULAS_PPSTR_MACRO, ULAS_PPDIR_MACRO),
+    ARCHSGEN_PPDIR(ULAS_PPSTR_IFDEF, ULAS_PPDIR_IFDEF),
+    ARCHSGEN_PPDIR(ULAS_PPSTR_IFNDEF, ULAS_PPDIR_IFNDEF),
+    ARCHSGEN_PPDIR(ULAS_PPSTR_ENDIF, ULAS_PPDIR_ENDIF),
+    ARCHSGEN_PPDIR(ULAS_PPSTR_ENDMACRO, ULAS_PPDIR_ENDMACRO),
+    ARCHSGEN_PPDIR(ULAS_PPSTR_UNDEF, ULAS_PPDIR_UNDEF),
+    ARCHSGEN_PPDIR(ULAS_PPSTR_INCLUDE, ULAS_PPDIR_INCLUDE),
+
+    ARCHSGEN_ASMDIR(ULAS_ASMSTR_ORG, ULAS_ASMDIR_ORG),
+    ARCHSGEN_ASMDIR(ULAS_ASMSTR_SET, ULAS_ASMDIR_SET),
+    ARCHSGEN_ASMDIR(ULAS_ASMSTR_BYTE, ULAS_ASMDIR_BYTE),
+    ARCHSGEN_ASMDIR(ULAS_ASMSTR_STR, ULAS_ASMDIR_STR),
+    ARCHSGEN_ASMDIR(ULAS_ASMSTR_FILL, ULAS_ASMDIR_FILL),
+    ARCHSGEN_ASMDIR(ULAS_ASMSTR_PAD, ULAS_ASMDIR_PAD),
+    ARCHSGEN_ASMDIR(ULAS_ASMSTR_INCBIN, ULAS_ASMDIR_INCBIN),
+    ARCHSGEN_ASMDIR(ULAS_ASMSTR_DEF, ULAS_ASMDIR_DEF),
+    ARCHSGEN_ASMDIR(ULAS_ASMSTR_CHKSM, ULAS_ASMDIR_CHKSM),
+    ARCHSGEN_ASMDIR(ULAS_ASMSTR_ADV, ULAS_ASMDIR_ADV),
+    ARCHSGEN_ASMDIR(ULAS_ASMSTR_SET_ENUM_DEF, ULAS_ASMDIR_SET_ENUM_DEF),
+    ARCHSGEN_ASMDIR(ULAS_ASMSTR_DEFINE_ENUM, ULAS_ASMDIR_DEFINE_ENUM),
+    ARCHSGEN_ASMDIR(ULAS_ASMSTR_SETCHRCODE, ULAS_ASMDIR_SETCHRCODE),
+    ARCHSGEN_ASMDIR(ULAS_ASMSTR_CHR, ULAS_ASMDIR_CHR),
+    ARCHSGEN_ASMDIR(ULAS_ASMSTR_REP, ULAS_ASMDIR_REP),
+    ARCHSGEN_ASMDIR(ULAS_ASMSTR_ALIGN, ULAS_ASMDIR_ALIGN),
+    {NULL}};
+
+// must match ulas_archhash in archs.c
+unsigned int archsgen_hash(const char *s, unsigned long n, unsigned int seed) {
+  unsigned int h = seed;
+  for (unsigned long i = 0; i < n && s[i]; i++) {
+    h ^= (unsigned char)s[i];
+    h *= 16777619u;
+  }
+  // fold the high bits in, the low bits alone depend on too little input
+  return h ^ (h >> 16);
+}
+
+// finds a seed that maps every name to its own slot
+// slots is set to the index of the name in each slot or -1
+// returns the table length
+unsigned long archsgen_perfecthash(const char **names, unsigned long len,
+                                   unsigned int *seed, int *slots) {
+  unsigned long hash_len = 1;
+  while (hash_len < len * 2) {
+    hash_len *= 2;
+  }
+
+  *seed = ARCHSGEN_SEED;
+  for (;;) {
+    memset(slots, -1, sizeof(int) * hash_len);
+    unsigned long i = 0;
+    for (; i < len; i++) {
+      unsigned int slot =
+          archsgen_hash(names[i], strlen(names[i]), *seed) & (hash_len - 1);
+      if (slots[slot] != -1) {
+        break;
+      }
+      slots[slot] = (int)i;
+    }
+    if (i == len) {
+      return hash_len;
+    }
+
+    // try a larger table if no seed is found quickly
+    if (++*seed - ARCHSGEN_SEED > ARCHSGEN_SEEDTRIES) {
+      *seed = ARCHSGEN_SEED;
+      hash_len *= 2;
+      assert(hash_len <= ARCHSGEN_HASHMAX);
+    }
+  }
+}
+
+int archsgen_byte(short dat) {
+  if (dat == (short)ULAS_DATZERO) {
+    return 0;
+  }
+  if (dat < 0 || dat > 0xFF) {
+    return -1;
+  }
+  return dat;
+}
+
+// the jump kind of an instruction as an enum ulas_jumpkind name
+const char *archsgen_jump(const struct ulas_instr *instr) {
+  if (strcmp(instr->name, "jr") == 0) {
+    return "ULAS_JUMP_REL8";
+  }
+  if (strcmp(instr->name, "rst") == 0) {
+    return "ULAS_JUMP_RST";
+  }
+  if (strcmp(instr->name, "jp") == 0 || strcmp(instr->name, "call") == 0) {
+    // jp hl has no target known ahead of time
+    for (int d = 0; instr->data[d]; d++) {
+      if (instr->data[d] == ULAS_A16 || instr->data[d] == ULAS_E16) {
+        return "ULAS_JUMP_ABS16";
+      }
+    }
+  }
+  return "ULAS_JUMP_NONE";
+}
+
+void archsgen_ranges(const char *name, const struct archsgen_mnemonic *ranges,
+                     unsigned long len) {
+  printf("static const struct ulas_instrrange %s[%lu] = {\n", name, len);
+  for (unsigned long i = 0; i < len; i++) {
+    printf("    {%u, %u},\n", ranges[i].start, ranges[i].len);
+  }
+  printf("};\n\n");
+}
+
+void archsgen_index(const char *name, const unsigned int *index,
+                    unsigned long len) {
+  printf("static const unsigned int %s[%lu] = {", name, len + 1);
+  for (unsigned long i = 0; i < len; i++) {
+    printf("%s%u,", i % 16 == 0 ? "\n    " : " ", index[i]);
+  }
+  printf("\n    0};\n\n");
+}
+
+int main(int argc, char **argv) {
+  const struct ulas_instr *instrs = ULASINSTRS_SM83;
+  assert(sizeof(ULAS_SM83_REGS) / sizeof(char *) == ULAS_SM83_REGS_LEN);
+
+  unsigned long instrs_len = 0;
+  while (instrs[instrs_len].name) {
+    instrs_len++;
+  }
+  assert(instrs_len < ARCHSGEN_INSTRSMAX);
+
+  // collect mnemonics in order of first appearance
+  static struct archsgen_mnemonic mnemonics[ARCHSGEN_MNEMONICSMAX];
+  static unsigned int mnemonic_of[ARCHSGEN_INSTRSMAX];
+  unsigned long mnemonics_len = 0;
+  for (unsigned long i = 0; i < instrs_len; i++) {
+    unsigned long m = 0;
+    while (m < mnemonics_len && strcmp(mnemonics[m].name, instrs[i].name)) {
+      m++;
+    }
+    if (m == mnemonics_len) {
+      assert(mnemonics_len < ARCHSGEN_MNEMONICSMAX);
+      mnemonics[mnemonics_len++].name = instrs[i].name;
+    }
+    mnemonics[m].len++;
+    mnemonic_of[i] = m;
+  }
+
+  // group instrs by mnemonic, keeping the table's order within a group
+  static unsigned int instrs_index[ARCHSGEN_INSTRSMAX];
+  unsigned int start = 0;
+  for (unsigned long m = 0; m < mnemonics_len; m++) {
+    mnemonics[m].start = start;
+    start += mnemonics[m].len;
+    mnemonics[m].len = 0;
+  }
+  for (unsigned long i = 0; i < instrs_len; i++) {
+    struct archsgen_mnemonic *m = &mnemonics[mnemonic_of[i]];
+    instrs_index[m->start + m->len++] = i;
+  }
+
+  static const char *names[ARCHSGEN_KEYWORDSMAX];
+  for (unsigned long m = 0; m < mnemonics_len; m++) {
+    names[m] = mnemonics[m].name;
+  }
+  static int slots[ARCHSGEN_HASHMAX];
+  unsigned int seed = 0;
+  unsigned long hash_len =
+      archsgen_perfecthash(names, mnemonics_len, &seed, slots);
+
+  // directives and the distinct register names
+  // registers that share a name map to the first register of that name
+  static struct archsgen_keyword keywords[ARCHSGEN_KEYWORDSMAX];
+  static char values[ULAS_SM83_REGS_LEN][16];
+  static unsigned int regs_canon[ULAS_SM83_REGS_LEN];
+  unsigned long keywords_len = 0;
+  for (; ARCHSGEN_DIRS[keywords_len].name; keywords_len++) {
+    keywords[keywords_len] = ARCHSGEN_DIRS[keywords_len];
+  }
+  for (unsigned int r = 1; r < ULAS_SM83_REGS_LEN; r++) {
+    regs_canon[r] = r;
+    for (unsigned int other = 1; other < r; other++) {
+      if (strcmp(ULAS_SM83_REGS[other], ULAS_SM83_REGS[r]) == 0) {
+        regs_canon[r] = other;
+        break;
+      }
+    }
+    if (regs_canon[r] != r) {
+      continue;
+    }
+
+    assert(keywords_len < ARCHSGEN_KEYWORDSMAX);
+    snprintf(values[r], 16, "%u", r);
+    keywords[keywords_len++] =
+        (struct archsgen_keyword){ULAS_SM83_REGS[r], "ULAS_KW_REG", values[r]};
+  }
+
+  for (unsigned long k = 0; k < keywords_len; k++) {
+    names[k] = keywords[k].name;
+  }
+  static int keyword_slots[ARCHSGEN_HASHMAX];
+  unsigned int keywords_seed = 0;
+  unsigned long keywords_hash_len =
+      archsgen_perfecthash(names, keywords_len, &keywords_seed, keyword_slots);
+
+  // decode tables of the first opcode byte
+  // prefixed instructions are placed by the byte after the prefix
+  // the first instruction in table order wins
+  static struct archsgen_mnemonic decode[ARCHSGEN_OPCODES * 2];
+  for (unsigned long i = 0; i < instrs_len; i++) {
+    int op = archsgen_byte(instrs[i].data[0]);
+    if (op == -1) {
+      fprintf(stderr, "%s: opcode of '%s' is not a constant\n", argv[0],
+              instrs[i].name);
+      return 1;
+    }
+
+    if (op == ARCHSGEN_PREFIX && archsgen_byte(instrs[i].data[1]) != -1 &&
+        instrs[i].data[1]) {
+      op = ARCHSGEN_OPCODES + archsgen_byte(instrs[i].data[1]);
+    }
+    if (decode[op].len) {
+      continue;
+    }
+
+    // length in bytes, 16 bit operands take 2
+    unsigned int len = 0;
+    for (int d = 0; instrs[i].data[d]; d++) {
+      short dat = instrs[i].data[d];
+      len += dat == ULAS_A16 || dat == ULAS_E16 ? 2 : 1;
+    }
+    decode[op].start = i;
+    decode[op].len = len;
+  }
+
+  printf("// generated by archsgen.c, do not edit\n");
+  printf("#ifndef ARCHS_SM83_GEN_H_\n#define ARCHS_SM83_GEN_H_\n\n");
+
+  printf("static const struct ulas_mnemonic ULAS_SM83_MNEMONICS[%lu] = {\n",
+         hash_len);
+  for (unsigned long i = 0; i < hash_len; i++) {
+    if (slots[i] == -1) {
+      printf("    {NULL, {0, 0}},\n");
+    } else {
+      const struct archsgen_mnemonic *m = &mnemonics[slots[i]];
+      printf("    {\"%s\", {%u, %u}},\n", m->name, m->start, m->len);
+    }
+  }
+  printf("};\n\n");
+
+  printf("static const struct ulas_keyword ULAS_SM83_KEYWORDS[%lu] = {\n",
+         keywords_hash_len);
+  for (unsigned long i = 0; i < keywords_hash_len; i++) {
+    if (keyword_slots[i] == -1) {
+      printf("    {NULL, ULAS_KW_NONE, 0},\n");
+    } else {
+      const struct archsgen_keyword *k = &keywords[keyword_slots[i]];
+      printf("    {\"%s\", %s, %s},\n", k->name, k->kind, k->value);
+    }
+  }
+  printf("};\n\n");
+
+  printf("static const unsigned int ULAS_SM83_REGS_CANON[%d] = {\n    0,",
+         ULAS_SM83_REGS_LEN);
+  for (unsigned int r = 1; r < ULAS_SM83_REGS_LEN; r++) {
+    printf(" %u,", regs_canon[r]);
+  }
+  printf("\n};\n\n");
+
+  archsgen_index("ULAS_SM83_INSTRS_INDEX", instrs_index, instrs_len);
+  archsgen_ranges("ULAS_SM83_DECODE", decode, ARCHSGEN_OPCODES);
+  archsgen_ranges("ULAS_SM83_DECODE_PREFIXED", decode + ARCHSGEN_OPCODES,
+                  ARCHSGEN_OPCODES);
+
+  printf("static const unsigned char ULAS_SM83_JUMPS[%lu] = {\n", instrs_len);
+  for (unsigned long i = 0; i < instrs_len; i++) {
+    printf("    %s,\n", archsgen_jump(&instrs[i]));
+  }
+  printf("};\n\n");
+
+  printf("static const struct ulas_archtables ULAS_SM83_TABLES = {\n");
+  printf("    ULAS_SM83_MNEMONICS, %lu, %uu,\n", hash_len, seed);
+  printf("    ULAS_SM83_KEYWORDS, %lu, %uu,\n", keywords_hash_len,
+         keywords_seed);
+  printf("    ULAS_SM83_REGS_CANON,\n");
+  printf("    ULAS_SM83_INSTRS_INDEX, 0x%X,\n", ARCHSGEN_PREFIX);
+  printf("    ULAS_SM83_DECODE, ULAS_SM83_DECODE_PREFIXED,\n");
+  printf("    ULAS_SM83_JUMPS};\n\n");
+
+  printf("#endif\n");
+  return 0;
+}
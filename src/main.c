@@ -20,27 +20,35 @@
 #define ULAS_VER "0.0.1"
 
 // args without value
-#define ULAS_OPTS "hvVpdA"
+#define ULAS_OPTS "hvVpdAcFu"
 
 // args with value
-#define ULAS_OPTS_ARG "o:l:s:i:w:a:S:"
+#define ULAS_OPTS_ARG "o:l:s:i:w:a:S:L:P:"
 
 #define ULAS_HELP(a, desc) printf("\t-%s\t%s\n", (a), desc);
 
 #define ULAS_INCPATHSMAX 256
+#define ULAS_SYMIMPORTSMAX 256
 
 char *incpaths[ULAS_INCPATHSMAX];
 unsigned long incpathslen = 0;
 
+char *symimports[ULAS_SYMIMPORTSMAX];
+unsigned long symimportslen = 0;
+
 void ulas_help(void) {
   printf("%s\n", ULAS_NAME);
-  printf("Usage %s [-%s] [-o=path] [-i=path] [-l=path] [-a=initial-address] [-S=ulas|mlb] "
-         "[input]\n\n",
+  printf("Usage %s [-%s] [-o=path] [-i=path] [-l=path] [-a=initial-address] [-S=ulas|mlb|bin] "
+         "[-L=path] [-P=path] [input]\n\n",
          ULAS_NAME, ULAS_OPTS);
   ULAS_HELP("h", "display this help and exit");
   ULAS_HELP("V", "display version info and exit");
   ULAS_HELP("v", "verbose output");
   ULAS_HELP("p", "Stop after preprocessor");
+  ULAS_HELP("c", "Check the input for errors without writing any output");
+  ULAS_HELP("F", "Fix the header and global checksum of the output");
+  ULAS_HELP("u", "Only rewrite the changed parts of an existing output file");
+  ULAS_HELP("P=path", "Write an ips patch against a reference rom");
   ULAS_HELP("o=path", "Output file");
   ULAS_HELP("l=path", "Listing file");
   ULAS_HELP("s=path", "Symbols file");
@@ -49,6 +57,7 @@ void ulas_help(void) {
   ULAS_HELP("A", "Print addresses in disassembler mode");
   ULAS_HELP("d", "Disassemble a file");
   ULAS_HELP("S", "Set the symbol format");
+  ULAS_HELP("L=path", "Import symbols of a previous build (ulas or bin)");
   ULAS_HELP("w=warning", "Toggle warnings: a=all, o=overflow");
 }
 
@@ -80,6 +89,15 @@ void ulas_getopt(int argc, char **argv, struct ulas_config *cfg) {
     case 'p':
       cfg->preproc_only = 1;
       break;
+    case 'c':
+      cfg->check_only = 1;
+      break;
+    case 'F':
+      cfg->fix_chksm = 1;
+      break;
+    case 'u':
+      cfg->update_output = 1;
+      break;
     case 's':
       cfg->sym_path = strndup(optarg, ULAS_PATHMAX);
       break;
@@ -90,6 +108,13 @@ void ulas_getopt(int argc, char **argv, struct ulas_config *cfg) {
       assert(incpathslen < ULAS_INCPATHSMAX);
       incpaths[incpathslen++] = strndup(optarg, ULAS_PATHMAX);
       break;
+    case 'P':
+      cfg->patch_ref = strndup(optarg, ULAS_PATHMAX);
+      break;
+    case 'L':
+      assert(symimportslen < ULAS_SYMIMPORTSMAX);
+      symimports[symimportslen++] = strndup(optarg, ULAS_PATHMAX);
+      break;
     case 'a':
       cfg->org = strtol(optarg, NULL, 0);
       break;
@@ -107,6 +132,8 @@ void ulas_getopt(int argc, char **argv, struct ulas_config *cfg) {
         cfg->sym_fmt = ULAS_SYM_FMT_DEFAULT; 
       } else if (strcmp("mlb", optarg) == 0) {
         cfg->sym_fmt = ULAS_SYM_FMT_MLB; 
+      } else if (strcmp("bin", optarg) == 0) {
+        cfg->sym_fmt = ULAS_SYM_FMT_BIN;
       } else {
         printf("Invalid symbol format: %s\n", optarg);
         exit(-1);
@@ -133,6 +160,8 @@ int main(int argc, char **argv) {
   ulas_getopt(argc, argv, &cfg);
   cfg.incpaths = incpaths;
   cfg.incpathslen = incpathslen;
+  cfg.sym_imports = symimports;
+  cfg.sym_importslen = symimportslen;
 
   int res = ulas_main(cfg);
 
@@ -148,9 +177,17 @@ int main(int argc, char **argv) {
     free(cfg.lst_path);
   }
 
+  if (cfg.patch_ref) {
+    free(cfg.patch_ref);
+  }
+
   for (int i = 0; i < incpathslen; i++) {
     free(incpaths[i]);
   }
 
+  for (int i = 0; i < symimportslen; i++) {
+    free(symimports[i]);
+  }
+
   return res;
 }
@@ -1,4 +1,5 @@
 #include "ulas.h"
+#include "uldas.h"
 #include <stdio.h>
 #include <assert.h>
 
@@ -73,9 +74,46 @@ void test_strbuf(void) {
 
   ulas_strfree(&s);
 
+  char trim[] = "ab\n\n";
+  ulas_trimend('\n', trim, sizeof(trim));
+  assert(strcmp(trim, "ab") == 0);
+  ulas_trimend('b', trim, sizeof(trim));
+  assert(strcmp(trim, "a") == 0);
+  ulas_trimend('a', trim, sizeof(trim));
+  assert(strcmp(trim, "") == 0);
+
   TESTEND("strbuf");
 }
 
+void test_fbuf(void) {
+  TESTBEGIN("fbuf");
+
+  char dstbuf[64];
+  memset(dstbuf, 0, 64);
+  FILE *dst = fmemopen(dstbuf, 64, "we");
+
+  // small buffer to force flushes
+  struct ulas_fbuf fb = ulas_fbuf(dst, 4);
+  ulas_fbufhex(&fb, 0, 0, 0);
+  ulas_fbufputc(&fb, ' ');
+  ulas_fbufhex(&fb, 0x1a2b, 0, 0);
+  ulas_fbufputc(&fb, ' ');
+  ulas_fbufhex(&fb, 0xAB, 8, 1);
+  ulas_fbufputs(&fb, " long text", 10);
+  ulas_fbufputc(&fb, ' ');
+  ulas_fbufdec(&fb, 0, 0);
+  ulas_fbufputc(&fb, ' ');
+  ulas_fbufdec(&fb, 12, 4);
+  ulas_fbufputc(&fb, ' ');
+  ulas_fbufdec(&fb, 123456, 4);
+  ulas_fbuffree(&fb);
+  fclose(dst);
+
+  assert(strcmp(dstbuf, "0 1a2b 000000AB long text 0 0012 123456") == 0);
+
+  TESTEND("fbuf");
+}
+
 #define assert_preproc(expect_dst, expect_ret, input)                          \
   {                                                                            \
     ulas_preprocclear(&ulas.pp);                                               \
@@ -181,8 +219,10 @@ void test_preproc(void) {
     struct ulas_tok tok = ulas_totok((token), strlen(token), &rc);             \
     assert((expected_rc) == rc);                                               \
     assert(tok.type == ULAS_SYMBOL);                                           \
-    assert(strcmp((expected_val), tok.val.strv) == 0);                         \
-    free(tok.val.strv);                                                        \
+    assert(strcmp((expected_val),                                              \
+                  ulas_internstr(&ulas.atoms, tok.val.atom)) == 0);            \
+    assert(tok.val.atom ==                                                     \
+           ulas_internfind(&ulas.atoms, (token), strlen(token)));              \
   }
 
 #define ASSERT_UNEXPECTED_TOTOK(expected_rc, token)                            \
@@ -244,6 +284,38 @@ void test_totok(void) {
   TESTEND("totok");
 }
 
+void test_intern(void) {
+  TESTBEGIN("intern");
+
+  unsigned int a1 = ulas_internpush(&ulas.atoms, "label1", 6);
+  unsigned int a2 = ulas_internpush(&ulas.atoms, "label2", 6);
+  assert(a1 && a2 && a1 != a2);
+  assert(ulas_internpush(&ulas.atoms, "label1:", 6) == a1);
+  assert(ulas_internfind(&ulas.atoms, "label2", 64) == a2);
+  assert(ulas_internfind(&ulas.atoms, "label3", 6) == 0);
+  assert(strcmp(ulas_internstr(&ulas.atoms, a1), "label1") == 0);
+
+  // directives and registers are in the generated keyword table
+  assert(ulas_arch_keyword(ULAS_ASMSTR_ORG, 4)->value == ULAS_ASMDIR_ORG);
+  assert(ulas_arch_keyword(ULAS_PPSTR_INCLUDE, 8)->value ==
+         ULAS_PPDIR_INCLUDE);
+  assert(ulas_arch_keyword("hl", 2)->value == ULAS_REGSM83_HL);
+  assert(ulas_arch_keyword("h", 1)->value == ULAS_REGSM83_H);
+  assert(!ulas_arch_keyword(".orgx", 5));
+  assert(!ulas_arch_keyword(".or", 3));
+
+  // force the table to grow
+  char name[32];
+  for (int i = 0; i < 1000; i++) {
+    sprintf(name, "sym%d", i);
+    ulas_internpush(&ulas.atoms, name, strlen(name));
+  }
+  assert(ulas_internfind(&ulas.atoms, "label1", 6) == a1);
+  assert(ulas_internfind(&ulas.atoms, "sym999", 6));
+
+  TESTEND("intern");
+}
+
 #define ASSERT_INTEXPR(expected_val, expected_rc, expr)                        \
   {                                                                            \
     int rc = 0;                                                                \
@@ -340,10 +412,359 @@ void test_asminstr(void) {
   ASSERT_ASMINSTR(1, "halt", 0x76);
   ASSERT_ASMINSTR(1, "ld b, c", 0x41);
   ASSERT_ASMINSTR(2, "ldh a, [1 + 2]", 0xF0, 0x03);
+  ASSERT_ASMINSTR(1, "ld a, [hl+]", 0x2A);
+  ASSERT_ASMINSTR(2, "ld hl, sp + 4", 0xF8, 0x04);
+  ASSERT_ASMINSTR(3, "ld [2 * 3], a", 0xEA, 0x06, 0x00);
+  ASSERT_ASMINSTR(2, "ld [hl], 1 + 1", 0x36, 0x02);
+  ASSERT_ASMINSTR(-1, "ld [hl+], b", 0x00);
+
+  // symbol-free lines are cached by their normalised text
+  const char *end = NULL;
+  const char *cached = "ld  a,\t[hl+]  ; comment";
+  assert(ulas_linecachekey(&ulas.linecache, cached, strlen(cached), &end));
+  assert(strcmp(ulas.linecache.key, "ld a, [hl+]") == 0);
+  assert(*end == ';');
+  assert(ulas_linecacheget(&ulas.linecache)->len == 1);
+  ASSERT_ASMINSTR(1, cached, 0x2A);
+  assert(!ulas_linecachekey(&ulas.linecache, "ld a, \"a\"", 10, &end));
 
   TESTEND("asminstr");
 }
 
+#define ASSERT_DECODE(expect_name, expect_len, ...)                            \
+  {                                                                            \
+    const char buf[] = {__VA_ARGS__};                                          \
+    const struct ulas_instrrange *d = ulas_arch_decode(buf, sizeof(buf));      \
+    const char *expect = (expect_name);                                        \
+    if (expect) {                                                              \
+      assert(d && d->len == (expect_len));                                     \
+      assert(strcmp(ulas.arch.instrs[d->start].name, expect) == 0);            \
+    } else {                                                                   \
+      assert(!d);                                                              \
+    }                                                                          \
+  }
+
+void test_decode(void) {
+  TESTBEGIN("decode");
+
+  ASSERT_DECODE("nop", 1, 0x00);
+  ASSERT_DECODE("jp", 3, (char)0xC3, 0x50, 0x01);
+  ASSERT_DECODE("ld", 3, 0x01, 0x00, 0x00);
+  ASSERT_DECODE("rl", 2, (char)0xCB, 0x11);
+  ASSERT_DECODE("bit", 2, (char)0xCB, 0x46);
+  // too short and unused opcodes
+  ASSERT_DECODE(NULL, 0, (char)0xC3, 0x50);
+  ASSERT_DECODE(NULL, 0, (char)0xD3);
+
+  TESTEND("decode");
+}
+
+#define ASSERT_ASMBULK(fn, expect_len, expect_end, line, ...)                 \
+  {                                                                            \
+    const char *l = line;                                                      \
+    char dst[64];                                                              \
+    char expect_dst[] = {__VA_ARGS__};                                         \
+    long res = fn(dst, 64, &l, strlen(l));                                     \
+    assert(res == expect_len);                                                 \
+    assert(strcmp(l, (expect_end)) == 0);                                      \
+    assert(res <= 0 || memcmp(dst, expect_dst, res) == 0);                     \
+  }
+
+void test_asmbulk(void) {
+  TESTBEGIN("asmbulk");
+
+  ASSERT_ASMBULK(ulas_asmbulkbyte, 3, "", " 1, 0x10, 0b11", 1, 0x10, 3);
+  ASSERT_ASMBULK(ulas_asmbulkbyte, 2, "; c\n", " 010 ,256 ; c\n", 8, 0);
+  ASSERT_ASMBULK(ulas_asmbulkbyte, -1, " 1 + 2", " 1 + 2", 0);
+  ASSERT_ASMBULK(ulas_asmbulkbyte, -1, " 1, a", " 1, a", 0);
+  ASSERT_ASMBULK(ulas_asmbulkbyte, -1, " 1,", " 1,", 0);
+
+  ASSERT_ASMBULK(ulas_asmbulkstr, 4, "\n", " \"ab\", \"\\n\\\"\"\n", 'a', 'b',
+                 '\n', '"');
+  ASSERT_ASMBULK(ulas_asmbulkstr, -1, " \"ab\" 1", " \"ab\" 1", 0);
+  ASSERT_ASMBULK(ulas_asmbulkstr, -1, " \"ab", " \"ab", 0);
+  // left to the general path
+  ASSERT_ASMBULK(ulas_asmbulkstr, -1, " \"a\\0b\"", " \"a\\0b\"", 0);
+  ASSERT_ASMBULK(ulas_asmbulkstr, -1, " \"a\\q\"", " \"a\\q\"", 0);
+
+  TESTEND("asmbulk");
+}
+
+#define ASSERT_ASMREP(expect_rc, expect_len, line)                             \
+  {                                                                            \
+    struct ulas_repexpr exprs[4];                                              \
+    int len = 0;                                                               \
+    const char *l = line;                                                      \
+    assert(ulas_asmrepcompile(exprs, &len, 4, l, strlen(l)) == expect_rc);     \
+    assert(len == expect_len);                                                 \
+    for (int i = 0; i < len; i++) {                                            \
+      ulas_tokbuffree(&exprs[i].toks);                                         \
+      ulas_exprbuffree(&exprs[i].exprs);                                       \
+    }                                                                          \
+  }
+
+void test_asmrep(void) {
+  TESTBEGIN("asmrep");
+
+  ASSERT_ASMREP(1, 2, " .db repi * 2, 3 ; comment");
+  ASSERT_ASMREP(0, 0, " ld a, repi");
+  ASSERT_ASMREP(0, 1, " .db repi ]");
+  ASSERT_ASMREP(0, 4, " .db 1, 2, 3, 4, 5");
+
+  // the loop variable shadows the symbol table
+  struct ulas_repvar var = {ulas_internpush(&ulas.atoms, "repi", 4), 7, NULL};
+  ulas.repvar = &var;
+  ASSERT_INTEXPR(14, 0, "repi * 2");
+  ulas.repvar = NULL;
+
+  // a failed expression writes nothing
+  struct ulas_repexpr exprs[4];
+  int len = 0;
+  const char *l = " .db 1, repnotfound, 2";
+  assert(ulas_asmrepcompile(exprs, &len, 4, l, strlen(l)) == 1);
+  int pass = ulas.pass;
+  ulas.pass = ULAS_PASS_FINAL;
+  unsigned int address = ulas.address;
+  struct ulas_sink sink = ulas_sinkmem();
+  assert(ulas_asmrepbyte(&sink, exprs, len, l) == -1);
+  assert(sink.len == 0 && ulas.address == address);
+  ulas_sinkfree(&sink);
+  for (int i = 0; i < len; i++) {
+    ulas_tokbuffree(&exprs[i].toks);
+    ulas_exprbuffree(&exprs[i].exprs);
+  }
+
+  // the loop variable never enters the symbol table
+  sink = ulas_sinkmem();
+  l = " repk, 3, 1, .db repk";
+  assert(ulas_asmdirrep(&sink, NULL, &l, strlen(l)) == 0);
+  assert(sink.len == 3 && memcmp(sink.buf, "\0\1\2", 3) == 0);
+  int rc = 0;
+  unsigned int repk = ulas_internfind(&ulas.atoms, "repk", 4);
+  assert(ulas_symbolresolve(repk, ulas.scope, &rc) == -1);
+  ulas_sinkfree(&sink);
+  ulas.address = address;
+  ulas.pass = pass;
+
+  TESTEND("asmrep");
+}
+
+void test_asmfill(void) {
+  TESTBEGIN("asmfill");
+
+  // the closed form checksum matches single byte writes
+  int pass = ulas.pass;
+  ulas.pass = ULAS_PASS_RESOLVE;
+  ulas.address = 0;
+  ulas.chksm = 0;
+  char val = (char)0xAB;
+  for (int i = 0; i < 300; i++) {
+    ulas_asmout(NULL, &val, 1);
+  }
+  char expect = ulas.chksm;
+  ulas.chksm = 0;
+  ulas_asmfill(NULL, val, 300);
+  assert(ulas.chksm == expect);
+  ulas.pass = pass;
+
+  TESTEND("asmfill");
+}
+
+void test_chksm(void) {
+  TESTBEGIN("chksm");
+
+  char img[0x4100];
+  for (unsigned long i = 0; i < sizeof(img); i++) {
+    img[i] = (char)(i * 7 + (i >> 8));
+  }
+
+  // odd lengths and offsets hit the tail loop
+  for (unsigned long off = 0; off < 9; off++) {
+    unsigned long expect = 0;
+    for (unsigned long i = off; i < sizeof(img) - off; i++) {
+      expect += (unsigned char)img[i];
+    }
+    assert(ulas_bytesum(img + off, sizeof(img) - off * 2) == expect);
+  }
+
+  struct ulas_sink sink = ulas_sinkmem();
+  int pass = ulas.pass;
+  ulas.pass = ULAS_PASS_FINAL;
+  ulas_nextpass();
+  // the output is only summed with -F
+  ulas_asmout(&sink, img, 0x10);
+  assert(ulas.outpos == 0);
+  sink.len = 0;
+
+  ulascfg.fix_chksm = 1;
+  ulas_asmout(&sink, img, 0x200);
+  ulas_asmfill(&sink, (char)0xFF, 0x3F00);
+  ulas_asmout(&sink, img + 0x200, 0x100);
+  assert(ulas_chksmfix(&sink) == 0);
+  ulascfg.fix_chksm = 0;
+  ulas.pass = pass;
+  assert(sink.len == 0x4200);
+  const char *out = sink.buf;
+
+  unsigned char hchksm = 0;
+  for (int i = ULAS_HEADER_START; i < ULAS_HEADER_CHKSM; i++) {
+    hchksm = (unsigned char)(hchksm - (unsigned char)out[i] - 1);
+  }
+  assert((unsigned char)out[ULAS_HEADER_CHKSM] == hchksm);
+
+  unsigned int sum = 0;
+  for (int i = 0; i < 0x4200; i++) {
+    if (i != ULAS_GLOBAL_CHKSM && i != ULAS_GLOBAL_CHKSM + 1) {
+      sum += (unsigned char)out[i];
+    }
+  }
+  assert((unsigned char)out[ULAS_GLOBAL_CHKSM] == ((sum >> 8) & 0xFF));
+  assert((unsigned char)out[ULAS_GLOBAL_CHKSM + 1] == (sum & 0xFF));
+  ulas_sinkfree(&sink);
+
+  TESTEND("chksm");
+}
+
+void test_lst(void) {
+  TESTBEGIN("lst");
+
+  char *filename = ulas.filename;
+  unsigned int address = ulas.address;
+  unsigned long line = ulas.line;
+  ulas.filename = "t.s";
+  ulas.address = 0x1234;
+  ulas.line = 7;
+
+  struct ulas_lstbuf lb = ulas_lstbuf();
+  ulas_lstbufpush(&lb, "ld a, 1\n", "\x3E\x01", 2);
+  ulas_lstbufpush(&lb, "jp 0x150\n", "\xC3\x50\x01\xFF", 4);
+
+  char out[256];
+  memset(out, 0, sizeof(out));
+  FILE *f = fmemopen(out, sizeof(out), "we");
+  ulas_lstrender(&lb, f);
+  fclose(f);
+  assert(lb.len == 0);
+  assert(strcmp(out, "00001234  3e 01 ....  (t.s:0007) ld a, 1\n"
+                     "00001234  c3 50 01 ff   (t.s:0007) jp 0x150\n") == 0);
+  ulas_lstbuffree(&lb);
+
+  ulas.filename = filename;
+  ulas.address = address;
+  ulas.line = line;
+
+  TESTEND("lst");
+}
+
+void test_sink(void) {
+  TESTBEGIN("sink");
+
+  // image sinks place bytes at their address
+  struct ulas_sink img = ulas_sinkimage(0x100);
+  assert(img.write(&img, 0x104, "\x01\x02", 2) == 0);
+  assert(img.write(&img, 0x101, "\x03", 1) == 0);
+  assert(img.len == 6 && memcmp(img.buf, "\0\x03\0\0\x01\x02", 6) == 0);
+  assert(img.write(&img, 0xFF, "\x04", 1) == -1);
+  assert(img.flush(&img) == -1);
+  // checksums cannot be patched into an address indexed image
+  assert(img.patch == NULL && ulas_chksmfix(&img) == -1);
+  ulas_sinkfree(&img);
+
+  // fd sinks buffer until flushed and patch written bytes
+  FILE *f = tmpfile();
+  struct ulas_sink fd = ulas_sinkfd(fileno(f));
+  assert(fd.write(&fd, 0, "abcd", 4) == 0);
+  assert(fd.patch(&fd, 1, "XY", 2) == 0);
+  assert(fd.patch(&fd, 3, "XY", 2) == -1);
+  assert(fd.write(&fd, 4, "e", 1) == 0);
+  assert(fd.flush(&fd) == 0);
+  char buf[8];
+  memset(buf, 0, sizeof(buf));
+  rewind(f);
+  assert(fread(buf, 1, sizeof(buf), f) == 5);
+  assert(strcmp(buf, "aXYde") == 0);
+  ulas_sinkfree(&fd);
+  fclose(f);
+
+  // update sinks only rewrite what changed
+  f = tmpfile();
+  char *rom = malloc(ULAS_BANKSIZE * 3);
+  memset(rom, 0x11, ULAS_BANKSIZE * 3);
+  fwrite(rom, 1, ULAS_BANKSIZE * 3, f);
+  fflush(f);
+  rom[ULAS_BANKSIZE + 5] = 0x22;
+  rom[ULAS_BANKSIZE + 9] = 0x22;
+  struct ulas_sink up = ulas_sinkupdate(fileno(f));
+  assert(up.write(&up, 0, rom, ULAS_BANKSIZE * 2) == 0);
+  assert(up.write(&up, 0, "\x33", 1) == 0);
+  assert(up.flush(&up) == 0);
+  // bytes 5-9 of bank 1 and the first byte of bank 2
+  assert(ulas_sinkwritten(&up) == 6);
+  rom[ULAS_BANKSIZE * 2] = 0x33;
+  char *back = malloc(ULAS_BANKSIZE * 3);
+  rewind(f);
+  assert(fread(back, 1, ULAS_BANKSIZE * 3, f) == ULAS_BANKSIZE * 2 + 1);
+  assert(memcmp(back, rom, ULAS_BANKSIZE * 2 + 1) == 0);
+  free(back);
+  free(rom);
+  ulas_sinkfree(&up);
+  fclose(f);
+
+  TESTEND("sink");
+}
+
+#define ASSERT_IPS(ref, ref_len, img, img_len, expect, expect_len)          \
+  {                                                                            \
+    struct ulas_sink sink = ulas_sinkmem();                                    \
+    assert(ulas_ipsdiff(&sink, ref, ref_len, img, img_len) == 0);              \
+    assert(sink.len == expect_len);                                            \
+    assert(memcmp(sink.buf, expect, expect_len) == 0);                         \
+    ulas_sinkfree(&sink);                                                      \
+  }
+
+void test_ips(void) {
+  TESTBEGIN("ips");
+
+  const char *ref = "abcdefghijklmnop";
+  assert(ulas_diffnext(ref, "abcdefghijkXmnop", 16, 0) == 11);
+  assert(ulas_diffnext(ref, ref, 16, 3) == 16);
+
+  ASSERT_IPS(ref, 16, ref, 16, "PATCHEOF", 8);
+  // short equal gaps are merged into one record
+  ASSERT_IPS(ref, 16, "aXcXefghijklmnYp", 16,
+             "PATCH\0\0\1\0\3XcX\0\0\x0E\0\1YEOF", 22);
+  // growing and truncating
+  ASSERT_IPS(ref, 4, "abcdZ", 5, "PATCH\0\0\4\0\1ZEOF", 14);
+  ASSERT_IPS(ref, 16, "abXd", 4, "PATCH\0\0\2\0\1XEOF\0\0\4", 17);
+
+  TESTEND("ips");
+}
+
+void test_incbin(void) {
+  TESTBEGIN("incbin");
+
+  struct ulas_incbinbuf ib = ulas_incbinbuf();
+  const struct ulas_incbin *bin = ulas_incbinget(&ib, "tests/inc.bin");
+  assert(bin && bin->len == 4 && (unsigned char)bin->buf[1] == 0xBB);
+  // the mapping is only created once
+  assert(ulas_incbinget(&ib, "tests/inc.bin") == bin);
+  assert(ib.len == 1);
+  // files that cannot be mapped are read
+  bin = ulas_incbinget(&ib, "/dev/null");
+  assert(bin && bin->len == 0 && !bin->mapped);
+  ulas_incbinbuffree(&ib);
+
+  // an explicit length of -1 is not the rest of the file
+  int rc = 0;
+  const char *line = "\"tests/inc.bin\", 0, -1";
+  struct ulas_sink sink = ulas_sinkmem();
+  ulas_asmdirincbin(&sink, &line, strlen(line), &rc);
+  assert(rc == -1 && sink.len == 0);
+  ulas_sinkfree(&sink);
+
+  TESTEND("incbin");
+}
+
 #define ASSERT_SYMSCOPE(expect_ret, name, scope, constant)                     \
   {                                                                            \
     struct ulas_tok tok = {ULAS_INT, {0}};                                     \
@@ -372,6 +793,155 @@ void test_symscope(void) {
   TESTEND("symscope");
 }
 
+#define ASSERT_SYMNEAREST(expect_name, addr)                                   \
+  {                                                                            \
+    long i = ulas_symbolnearest((addr));                                       \
+    const char *expect = (expect_name);                                        \
+    if (expect) {                                                              \
+      assert(i != -1);                                                         \
+      assert(strcmp(ulas_internstr(&ulas.atoms, ulas.syms.names[i]),           \
+                    expect) == 0);                                             \
+    } else {                                                                   \
+      assert(i == -1);                                                         \
+    }                                                                          \
+  }
+
+void test_symnearest(void) {
+  TESTBEGIN("symnearest");
+
+  ulas_symbufclear(&ulas.syms);
+  int label = ULAS_SYMF_CONSTANT | ULAS_SYMF_LABEL;
+  struct ulas_tok tok = {ULAS_INT, {0x150}};
+  ulas_symbolset("l2:", -1, tok, label);
+  tok.val.intv = 0x100;
+  ulas_symbolset("l1:", -1, tok, label);
+  ulas_symbolset("@l1:", -1, tok, label);
+  tok.val.intv = 0x200;
+  ulas_symbolset("v1", -1, tok, 0);
+  tok.val.intv = 0x180;
+  ulas_symbolset("e1", -1, tok, ULAS_SYMF_CONSTANT);
+  ulas_symbufsort(&ulas.syms);
+
+  ASSERT_SYMNEAREST(NULL, 0xFF);
+  ASSERT_SYMNEAREST("l1", 0x100);
+  ASSERT_SYMNEAREST("l1", 0x14F);
+  ASSERT_SYMNEAREST("l2", 0x150);
+  // constants and variables are not labels
+  ASSERT_SYMNEAREST("l2", 0x180);
+  ASSERT_SYMNEAREST("l2", 0x200);
+
+  TESTEND("symnearest");
+}
+
+void test_symdb(void) {
+  TESTBEGIN("symdb");
+
+  ulas_symbufclear(&ulas.syms);
+  struct ulas_tok tok = {ULAS_INT, {0x150}};
+  ulas_symbolset("l2:", -1, tok, ULAS_SYMF_CONSTANT | ULAS_SYMF_LABEL);
+  tok.val.intv = 0x100;
+  ulas_symbolset("l1:", -1, tok, ULAS_SYMF_CONSTANT | ULAS_SYMF_LABEL);
+  tok.val.intv = 0x200;
+  ulas_symbolset("v1", -1, tok, 0);
+  tok.val.intv = 0x180;
+  ulas_symbolset("e1", -1, tok, ULAS_SYMF_CONSTANT);
+  struct ulas_tok str = {ULAS_STR, {0}};
+  str.val.strv = strdup("value");
+  ulas_symbolset("s1", -1, str, 0);
+
+  char dbbuf[1024];
+  memset(dbbuf, 0, 1024);
+  FILE *dst = fmemopen(dbbuf, 1024, "we");
+  ulascfg.sym_fmt = ULAS_SYM_FMT_BIN;
+  assert(ulas_symbolout(dst) == 0);
+  ulascfg.sym_fmt = ULAS_SYM_FMT_DEFAULT;
+  long len = ftell(dst);
+  fclose(dst);
+
+  struct ulas_symdb db;
+  assert(ulas_symdbopen(&db, dbbuf, 8) == -1);
+  assert(ulas_symdbopen(&db, dbbuf, len) == 0);
+  assert(db.header->entries_len == 5);
+  assert(db.header->labels_len == 2);
+
+  long i = ulas_symdbfind(&db, "l2", 2);
+  assert(i != -1 && db.entries[i].val == 0x150);
+  i = ulas_symdbfind(&db, "s1", 2);
+  assert(i != -1 && db.entries[i].type == ULAS_STR);
+  assert(strcmp(ulas_symdbstr(&db, db.entries[i].val), "value") == 0);
+  assert(ulas_symdbfind(&db, "l3", 2) == -1);
+
+  assert(ulas_symdbnearest(&db, 0xFF) == -1);
+  i = ulas_symdbnearest(&db, 0x14F);
+  assert(strcmp(ulas_symdbstr(&db, db.entries[i].name), "l1") == 0);
+  // constants and variables are not labels
+  i = ulas_symdbnearest(&db, 0x1FF);
+  assert(strcmp(ulas_symdbstr(&db, db.entries[i].name), "l2") == 0);
+  i = ulas_symdbnearest(&db, 0x200);
+  assert(strcmp(ulas_symdbstr(&db, db.entries[i].name), "l2") == 0);
+
+  ulas_symdbclose(&db);
+
+  // a short write is an error
+  dst = fmemopen(dbbuf, 16, "we");
+  ulascfg.sym_fmt = ULAS_SYM_FMT_BIN;
+  assert(ulas_symbolout(dst) == -1);
+  ulascfg.sym_fmt = ULAS_SYM_FMT_DEFAULT;
+  fclose(dst);
+
+  TESTEND("symdb");
+}
+
+void test_symimport(void) {
+  TESTBEGIN("symimport");
+
+  ulas_symbufclear(&ulas.syms);
+  struct ulas_tok tok = {ULAS_INT, {0x4000}};
+  ulas_symbolset("engine_tick", -1, tok, 1);
+  assert(ulas_symbolimport("tests/import.sym") == 0);
+  assert(ulas_symbolimport("tests/notfound.sym") == -1);
+
+  int rc = 0;
+  long i = ulas_symbolresolve(
+      ulas_internfind(&ulas.atoms, "engine_init", ULAS_SYMNAMEMAX), 0, &rc);
+  assert(i != -1);
+  assert(ulas.syms.vals[i].val.intv == 0x100);
+  assert(ulas.syms.flags[i] & ULAS_SYMF_IMPORTED);
+
+  // already defined symbols are not overwritten
+  i = ulas_symbolresolve(
+      ulas_internfind(&ulas.atoms, "engine_tick", ULAS_SYMNAMEMAX), 0, &rc);
+  assert(ulas.syms.vals[i].val.intv == 0x4000);
+
+  // the text format has no labels
+  ulas_symbufsort(&ulas.syms);
+  assert(ulas_symbolnearest(0x100) == -1);
+
+  // scoped symbols, strings and unnamed symbols are not imported
+  assert(ulas.syms.len == 2);
+
+  // the source cannot redefine an imported symbol in any pass
+  struct ulas_tok redef = {ULAS_INT, {0x200}};
+  ulas.pass = ULAS_PASS_RESOLVE;
+  assert(ulas_symbolset("engine_init", -1, redef, ULAS_SYMF_LABEL) == -1);
+  ulas.pass = ULAS_PASS_FINAL;
+  assert(ulas_symbolset("engine_init", -1, redef, ULAS_SYMF_LABEL) == -1);
+  i = ulas_symbolresolve(
+      ulas_internfind(&ulas.atoms, "engine_init", ULAS_SYMNAMEMAX), 0, &rc);
+  assert(ulas.syms.vals[i].val.intv == 0x100);
+  assert(ulas.syms.flags[i] & ULAS_SYMF_IMPORTED);
+
+  // imported symbols are not emitted again
+  char dstbuf[256];
+  memset(dstbuf, 0, 256);
+  FILE *dst = fmemopen(dstbuf, 256, "we");
+  ulas_symbolout(dst);
+  fclose(dst);
+  assert(strcmp(dstbuf, "engine_tick = 0x4000\n") == 0);
+
+  TESTEND("symimport");
+}
+
 #define ULAS_FULLEN 0xFFFF
 
 #define ASSERT_FULL(expect_rc, in_path, expect_path)                           \
@@ -387,9 +957,15 @@ void test_symscope(void) {
     fclose(expectf);                                                           \
     memset(dstbuf, 0, ULAS_FULLEN);                                            \
     ulasout = fmemopen(dstbuf, ULAS_FULLEN, "we");                             \
+    struct ulas_sink sink = ulas_sinkmem();                                    \
+    cfg.sink = &sink;                                                          \
     ulasin = fopen(in_path, "re");                                             \
     assert(ulas_main(cfg) == (expect_rc));                                     \
     fclose(ulasout);                                                           \
+    if (!cfg.disas) {                                                          \
+      memcpy(dstbuf, sink.buf, MIN(sink.len, ULAS_FULLEN));                    \
+    }                                                                          \
+    ulas_sinkfree(&sink);                                                      \
     for (int i = 0; i < expect_len; i++) {                                     \
       assert(expect[i] == dstbuf[i]);                                          \
       if (cfg.disas) {                                                         \
@@ -418,6 +994,22 @@ void test_full_asm(void) {
   TESTEND("testfullasm");
 }
 
+#define ASSERT_FULL_CHECK(expect_rc, in_path)                                  \
+  {                                                                            \
+    struct ulas_config cfg = ulas_cfg_from_env();                              \
+    cfg.check_only = 1;                                                        \
+    ASSERT_FULL(expect_rc, in_path, "/dev/null")                               \
+  }
+
+// check mode assembles everything but writes nothing
+void test_full_check(void) {
+  TESTBEGIN("testfullcheck");
+
+  ASSERT_FULL_CHECK(0, "tests/t0.s");
+
+  TESTEND("testfullcheck");
+}
+
 #define ASSERT_FULL_DASM(expect_rc, in_path, expect_path)                      \
   {                                                                            \
     struct ulas_config cfg = ulas_cfg_from_env();                              \
@@ -429,10 +1021,91 @@ void test_full_dasm(void) {
   TESTBEGIN("testfulldasm");
 
   ASSERT_FULL_DASM(0, "tests/t0.bin", "tests/t0_dasm.s");
+  // the output can be assembled again
+  ASSERT_FULL_ASM(0, "tests/t0_dasm.s", "tests/t0.bin");
 
   TESTEND("testfulldasm");
 }
 
+void test_dasmbanks(void) {
+  TESTBEGIN("dasmbanks");
+
+  // pseudo random code so instructions cross bank boundaries
+  unsigned long len = ULAS_BANKSIZE * 3 + 5;
+  char *data = malloc(len);
+  unsigned int seed = 1;
+  for (unsigned long i = 0; i < len; i++) {
+    seed = seed * 1103515245 + 12345;
+    data[i] = (char)(seed >> 16);
+  }
+  FILE *f = tmpfile();
+  assert(fwrite(data, 1, len, f) == len);
+  rewind(f);
+
+  struct ulas_dasmsrc src;
+  assert(ulas_dasmsrc(&src, f) == 0);
+  ulas.pass = ULAS_PASS_RESOLVE;
+  assert(ulas_dasm(&src, f) == 0);
+  ulas.pass = ULAS_PASS_FINAL;
+
+  char *serial = NULL;
+  size_t serial_len = 0;
+  FILE *dst = open_memstream(&serial, &serial_len);
+  struct ulas_fbuf fb = ulas_fbuf(dst, ULAS_DASM_OUTBUFMAX);
+  src.pos = 0;
+  src.end = src.len;
+  assert(ulas_dasm_range(&src, &fb) == 0);
+  ulas_fbuffree(&fb);
+  fclose(dst);
+
+  char *banked = NULL;
+  size_t banked_len = 0;
+  dst = open_memstream(&banked, &banked_len);
+  fb = ulas_fbuf(dst, ULAS_DASM_OUTBUFMAX);
+  assert(ulas_dasm_banks(&src, &fb, 3) == 0);
+  ulas_fbuffree(&fb);
+  fclose(dst);
+
+  assert(serial_len > 0 && serial_len == banked_len);
+  assert(memcmp(serial, banked, serial_len) == 0);
+
+  free(serial);
+  free(banked);
+  ulas_dasmsrcfree(&src);
+  fclose(f);
+  free(data);
+
+  TESTEND("dasmbanks");
+}
+
+void test_dasmsrc(void) {
+  TESTBEGIN("dasmsrc");
+
+  // regular files are mapped
+  struct ulas_dasmsrc src;
+  FILE *f = fopen("tests/t0.bin", "re");
+  assert(ulas_dasmsrc(&src, f) == 0);
+  assert(src.mapped && src.len > 0);
+  char first = 0;
+  assert(fread(&first, 1, 1, f) == 1 && first == src.buf[0]);
+  ulas_dasmsrcfree(&src);
+  fclose(f);
+
+  // streams are read into memory past the initial buffer size
+  char data[ULAS_DASM_READMAX + 3];
+  for (unsigned long i = 0; i < sizeof(data); i++) {
+    data[i] = (char)i;
+  }
+  f = fmemopen(data, sizeof(data), "re");
+  assert(ulas_dasmsrc(&src, f) == 0);
+  assert(!src.mapped && src.len == sizeof(data));
+  assert(memcmp(src.buf, data, sizeof(data)) == 0);
+  ulas_dasmsrcfree(&src);
+  fclose(f);
+
+  TESTEND("dasmsrc");
+}
+
 int main(int arc, char **argv) {
   TESTBEGIN("ulas test");
   ulas_init(ulas_cfg_from_env());
@@ -443,19 +1116,36 @@ int main(int arc, char **argv) {
 
   test_tok();
   test_strbuf();
+  test_fbuf();
   test_preproc();
   test_totok();
+  test_intern();
   test_intexpr();
   test_strexpr();
   test_asminstr();
+  test_decode();
+  test_dasmbanks();
+  test_asmbulk();
+  test_asmrep();
+  test_asmfill();
+  test_chksm();
+  test_lst();
+  test_sink();
+  test_ips();
+  test_incbin();
   test_symscope();
+  test_symnearest();
+  test_symdb();
+  test_symimport();
 
   ulas_free();
 
   // this will re-init everything on its own,
   // so call after free
   test_full_dasm();
+  test_dasmsrc();
   test_full_asm();
+  test_full_check();
 
   TESTEND("ulas test");
   return 0;
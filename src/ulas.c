@@ -1,10 +1,15 @@
 #include "ulas.h"
 #include <ctype.h>
 #include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 #include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "uldas.h"
 
 FILE *ulasin = NULL;
@@ -12,6 +17,7 @@ FILE *ulasout = NULL;
 FILE *ulaserr = NULL;
 FILE *ulaslstout = NULL;
 FILE *ulassymout = NULL;
+struct ulas_sink *ulassink = NULL;
 struct ulas_config ulascfg;
 struct ulas ulas;
 
@@ -40,9 +46,14 @@ void ulas_init(struct ulas_config cfg) {
   }
 
   ulas.pass = ULAS_PASS_FINAL;
+  ulas.atoms = ulas_intern();
   ulas.toks = ulas_tokbuf();
   ulas.exprs = ulas_exprbuf();
   ulas.syms = ulas_symbuf();
+  ulas.ops = ulas_opbuf();
+  ulas.linecache = ulas_linecache();
+  ulas.incbins = ulas_incbinbuf();
+  ulas.lst = ulas_lstbuf();
   ulas.pp = ulas_preprocinit();
   ulas.scope = 1;
 
@@ -58,6 +69,8 @@ void ulas_nextpass(void) {
   ulas.icntr = 0;
   ulas.address = ulascfg.org;
   ulas.chksm = 0;
+  ulas.outpos = 0;
+  memset(ulas.banksums, 0, sizeof(ulas.banksums));
   ulas.filename = ulas.initial_filename;
 
   for (int i = 0; i < ULAS_CHARCODEMAPLEN; i++) {
@@ -70,7 +83,12 @@ void ulas_free(void) {
   ulas_tokbuffree(&ulas.toks);
   ulas_exprbuffree(&ulas.exprs);
   ulas_symbuffree(&ulas.syms);
+  ulas_opbuffree(&ulas.ops);
+  ulas_linecachefree(&ulas.linecache);
+  ulas_incbinbuffree(&ulas.incbins);
+  ulas_lstbuffree(&ulas.lst);
   ulas_preprocfree(&ulas.pp);
+  ulas_internfree(&ulas.atoms);
 }
 
 FILE *ulas_incpathfopen(const char *path, const char *mode) {
@@ -150,9 +168,70 @@ int ulas_main(struct ulas_config cfg) {
   long long total_startusec = ulas_timeusec();
   int rc = 0;
   ulas_init(cfg);
-  if (cfg.output_path) {
+
+  // text output goes to ulasout, assembled bytes to ulassink
+  int textout = cfg.preproc_only || cfg.disas;
+  struct ulas_sink outsink = ulas_sinkfd(fileno(stdout));
+  int outfd = -1;
+  FILE *preprocdst = NULL;
+  struct ulas_dasmsrc dasmsrc;
+  memset(&dasmsrc, 0, sizeof(dasmsrc));
+  struct ulas_incbin patchref;
+  memset(&patchref, 0, sizeof(patchref));
+  ulassink = cfg.sink ? cfg.sink : &outsink;
+
+  if (cfg.check_only) {
+    // nothing is written in check mode
+    cfg.output_path = NULL;
+    cfg.sym_path = NULL;
+    cfg.lst_path = NULL;
+    ulassymout = NULL;
+    ulaslstout = NULL;
+    ulassink = NULL;
+  }
+
+  if (cfg.output_path && textout) {
     ULASDBG("output: %s\n", cfg.output_path);
     ulasout = ulas_fopen(cfg.output_path, "we", stdout);
+  } else if (cfg.output_path && !cfg.sink &&
+             strncmp(cfg.output_path, ULAS_STDFILEPATH, 1) != 0) {
+    ULASDBG("output: %s\n", cfg.output_path);
+    // the existing file is kept when updating it in place
+    int update = cfg.update_output && !cfg.patch_ref;
+    int flags = update ? O_RDWR : O_WRONLY | O_TRUNC;
+    outfd = open(cfg.output_path, flags | O_CREAT | O_CLOEXEC, 0666);
+    if (outfd == -1) {
+      ULASPANIC("%s: %s\n", cfg.output_path, strerror(errno));
+    }
+
+    if (update) {
+      ulas_sinkfree(&outsink);
+      outsink = ulas_sinkupdate(outfd);
+    } else {
+      ulas_sinkfree(&outsink);
+      outsink = ulas_sinkfd(outfd);
+    }
+  }
+
+  if (cfg.patch_ref && !textout && !cfg.sink) {
+    ULASDBG("patch against: %s\n", cfg.patch_ref);
+    // the reference is loaded like an included binary, but from the exact
+    // path given; the include search only applies to .incbin
+    FILE *f = fopen(cfg.patch_ref, "re");
+    if (!f) {
+      ULASERR("%s: %s\n", cfg.patch_ref, strerror(errno));
+      rc = -1;
+      goto cleanup;
+    }
+    int loaded = ulas_incbinload(&patchref, f, cfg.patch_ref);
+    fclose(f);
+    if (loaded == -1) {
+      rc = -1;
+      goto cleanup;
+    }
+    int fd = outfd != -1 ? outfd : fileno(stdout);
+    ulas_sinkfree(&outsink);
+    outsink = ulas_sinkips(fd, patchref.buf, patchref.len);
   }
 
   if (cfg.sym_path) {
@@ -169,11 +248,24 @@ int ulas_main(struct ulas_config cfg) {
     ULASDBG("input: %s\n", cfg.argv[0]);
     ulasin = ulas_fopen(cfg.argv[0], "re", stdin);
   }
-  FILE *preprocdst = NULL;
+
+  if (cfg.disas && ulas_dasmsrc(&dasmsrc, ulasin) == -1) {
+    rc = -1;
+    goto cleanup;
+  }
+
+  for (unsigned int i = 0; i < cfg.sym_importslen; i++) {
+    ULASDBG("import: %s\n", cfg.sym_imports[i]);
+    if (ulas_symbolimport(cfg.sym_imports[i]) == -1) {
+      rc = -1;
+      goto cleanup;
+    }
+  }
 
   // only do 2 pass if we have a file as input
   // because  we cannot really rewind stdout
-  if (!cfg.preproc_only && ulasin != stdin) {
+  // the disassembler keeps its input in memory
+  if (!cfg.preproc_only && (ulasin != stdin || cfg.disas)) {
     ulas.pass = ULAS_PASS_RESOLVE;
   }
 
@@ -198,12 +290,16 @@ int ulas_main(struct ulas_config cfg) {
         goto cleanup;
       }
     } else {
-      if (ulas_dasm(ulasin, ulasout) == -1) {
+      if (ulas_dasm(&dasmsrc, ulasout) == -1) {
         rc = -1;
         goto cleanup;
       }
     }
 
+    // labels do not move between passes
+    // so the index can be used by the next pass already
+    ulas_symbufsort(&ulas.syms);
+
     if (ulas.pass > ULAS_PASS_FINAL) {
       fclose(preprocdst);
       preprocdst = NULL;
@@ -212,12 +308,40 @@ int ulas_main(struct ulas_config cfg) {
     ulas.pass -= 1;
   }
 
+  if (cfg.fix_chksm && !cfg.check_only && !textout &&
+      ulas_chksmfix(ulassink) == -1) {
+    rc = -1;
+    goto cleanup;
+  }
+
 cleanup:
+  // rendered once here so a failed run still gets a partial listing;
+  // symbols follow the listing as before, but only on success
+  ulas_lstrender(&ulas.lst, ulaslstout);
+  if (rc != -1 && ulas_symbolout(ulassymout) == -1) {
+    rc = -1;
+  }
+
   if (!cfg.preproc_only && preprocdst) {
     ulas_fclose(preprocdst);
   }
+  ulas_dasmsrcfree(&dasmsrc);
+
+  if (ulassink && !textout && ulassink->flush(ulassink) == -1) {
+    ULASERR("Unable to write output: %s\n", strerror(errno));
+    rc = -1;
+  }
+  if (cfg.update_output && !cfg.patch_ref && outfd != -1) {
+    ULASDBG("updated %ld bytes\n", (long)ulas_sinkwritten(&outsink));
+  }
+  ulassink = NULL;
+  ulas_sinkfree(&outsink);
+  ulas_incbinfree(&patchref);
+  if (outfd != -1) {
+    close(outfd);
+  }
 
-  if (cfg.output_path) {
+  if (cfg.output_path && textout) {
     ulas_fclose(ulasout);
   }
 
@@ -268,21 +392,51 @@ int ulas_islabelname(const char *tok, unsigned long n) {
   return tok[n - 1] == ':' && (ulas_isname(tok, n - 1) || n == 1);
 }
 
-struct ulas_sym *ulas_symbolresolve(const char *name, int scope, int *rc) {
-  for (int i = 0; i < ulas.syms.len; i++) {
-    struct ulas_sym *sym = &ulas.syms.buf[i];
+long ulas_symbolresolve(unsigned int name, int scope, int *rc) {
+  const unsigned int *names = ulas.syms.names;
+  const int *scopes = ulas.syms.scopes;
+
+  for (unsigned long i = 0; i < ulas.syms.len; i++) {
     // when scope is the same as the current one, or scope 0 (global)
-    if ((sym->scope == 0 || sym->scope == scope) &&
-        strcmp(name, sym->name) == 0) {
-      return sym;
+    if (names[i] == name && (scopes[i] == 0 || scopes[i] == scope)) {
+      return (long)i;
     }
   }
   *rc = -1;
-  return NULL;
+  return -1;
+}
+
+long ulas_symbolnearest(unsigned int addr) {
+  struct ulas_symbuf *sb = &ulas.syms;
+
+  // find the first label that is > addr
+  unsigned long lo = 0;
+  unsigned long hi = sb->addrslen;
+  while (lo < hi) {
+    unsigned long mid = lo + (hi - lo) / 2;
+    if ((unsigned int)sb->vals[sb->addrs[mid]].val.intv <= addr) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  if (lo == 0) {
+    return -1;
+  }
+
+  // walk back to the first label at the same address
+  unsigned long found = lo - 1;
+  int val = sb->vals[sb->addrs[found]].val.intv;
+  while (found > 0 && sb->vals[sb->addrs[found - 1]].val.intv == val) {
+    found--;
+  }
+
+  return (long)sb->addrs[found];
 }
 
 int ulas_symbolset(const char *cname, int scope, struct ulas_tok tok,
-                   int constant) {
+                   int flags) {
   // remove : from name
   char name[ULAS_SYMNAMEMAX];
   memset(name, 0, ULAS_SYMNAMEMAX);
@@ -305,27 +459,32 @@ int ulas_symbolset(const char *cname, int scope, struct ulas_tok tok,
     }
   }
 
-  struct ulas_sym *existing = ulas_symbolresolve(name, scope, &resolve_rc);
+  unsigned int atom = ulas_internpush(&ulas.atoms, name, len);
+  long existing = ulas_symbolresolve(atom, scope, &resolve_rc);
   // inc scope when symbol is global
   if (name[0] != ULAS_TOK_SCOPED_SYMBOL_BEGIN && cname[len - 1] == ':') {
     ulas.scope++;
   }
 
-  if (!existing || (name[0] == '\0' && len == 1)) {
-    // def new symbol
-    struct ulas_sym new_sym = {strndup(name, len), tok, scope, ulas.pass,
-                               constant};
-    ulas_symbufpush(&ulas.syms, new_sym);
+  flags &= ULAS_SYMF_CONSTANT | ULAS_SYMF_LABEL;
+  if (ulas.pass == ULAS_PASS_RESOLVE) {
+    flags |= ULAS_SYMF_RESOLVE;
+  }
 
-    rc = ulas_symbolout(ulassymout, &new_sym);
-  } else if (existing->lastdefin != ulas.pass || !existing->constant) {
+  if (existing == -1 || (name[0] == '\0' && len == 1)) {
+    // def new symbol
+    ulas_symbufpush(&ulas.syms, atom, tok, scope, flags);
+  } else if (ulas.syms.flags[existing] & ULAS_SYMF_IMPORTED) {
+    // imports are never shadowed by the source
+    rc = -1;
+    ULASERR("Redefinition of imported symbol '%s'\n", name);
+  } else if ((ulas.syms.flags[existing] & ULAS_SYMF_RESOLVE) !=
+                 (flags & ULAS_SYMF_RESOLVE) ||
+             !(ulas.syms.flags[existing] & ULAS_SYMF_CONSTANT)) {
     // redefine if not defined this pass
-    existing->lastdefin = ulas.pass;
-    ulas_tokfree(&existing->tok);
-    existing->tok = tok;
-    existing->constant = constant;
-
-    rc = ulas_symbolout(ulassymout, existing);
+    ulas.syms.flags[existing] = flags;
+    ulas_tokfree(&ulas.syms.vals[existing]);
+    ulas.syms.vals[existing] = tok;
   } else {
     // exists.. cannot have duplicates!
     rc = -1;
@@ -334,89 +493,494 @@ int ulas_symbolset(const char *cname, int scope, struct ulas_tok tok,
   return rc;
 }
 
-int ulas_symbolout_mlbloc(FILE *dst, long addr) {
+// returns the mlb memory type of addr
+// and sets offset to the start address of that memory type
+const char *ulas_symbolout_mlbloc(long addr, int *offset) {
+  *offset = 0;
   if (addr == -1) {
-    fprintf(dst, "Unknown:");
-    return 0;
+    return "Unknown:";
   }
-  
-  // TODO: maybe allow the user to define this by using 
+
+  // TODO: maybe allow the user to define this by using
   // .section and just trust the label location in the source
   // is correct
   switch (ulas.arch.type) {
   case ULAS_ARCH_SM83:
     if (addr >= 0x0000 && addr <= 0x7FFF) {
-      fprintf(dst, "GbPrgRom:");
-      return 0;
+      return "GbPrgRom:";
     } else if (addr >= 0xC000 && addr <= 0xDFFF) {
-      fprintf(dst, "GbWorkRam:");
-      return 0xC000;
-    } else {
-      fprintf(dst, "Unknown:");
-      return 0;
+      *offset = 0xC000;
+      return "GbWorkRam:";
     }
     break;
   }
-  return 0;
+  return "Unknown:";
 }
 
-int ulas_symbolout(FILE *dst, struct ulas_sym *s) {
-  if (!dst || ulas.pass != ULAS_PASS_FINAL) {
-    return 0;
+void ulas_symbolfmt(struct ulas_fbuf *fb, unsigned long i) {
+  const char *name = ulas_internstr(&ulas.atoms, ulas.syms.names[i]);
+  struct ulas_tok *val = &ulas.syms.vals[i];
+  if (!name || name[0] == '\0') {
+    name = ULAS_SYMUNNAMED;
   }
-
-  int rc = 0;
+  unsigned long namelen = strlen(name);
 
   switch (ulascfg.sym_fmt) {
   case ULAS_SYM_FMT_DEFAULT:
-    if (!s->name || s->name[0] == '\0') {
-      fprintf(dst, "<unnamed> = ");
-    } else {
-      fprintf(dst, "%s = ", s->name);
-    }
-    switch (s->tok.type) {
+    ulas_fbufputs(fb, name, namelen);
+    ulas_fbufputs(fb, " = ", 3);
+    switch (val->type) {
     case ULAS_INT:
-      fprintf(dst, "0x%x", ulas_valint(&s->tok, &rc));
+      ulas_fbufputs(fb, "0x", 2);
+      ulas_fbufhex(fb, (unsigned int)val->val.intv, 0, 0);
       break;
     case ULAS_STR:
-      fprintf(dst, "%s", ulas_valstr(&s->tok, &rc));
+      ulas_fbufputs(fb, val->val.strv, strlen(val->val.strv));
       break;
     default:
-      fprintf(dst, "<Unknown type>");
+      ulas_fbufputs(fb, ULAS_SYMUNKNOWNTYPE, strlen(ULAS_SYMUNKNOWNTYPE));
       break;
     }
-    fprintf(dst, "\n");
     break;
-  case ULAS_SYM_FMT_MLB:
-    switch (s->tok.type) {
-    case ULAS_INT: {
-      int valint = ulas_valint(&s->tok, &rc);
-      valint -= ulas_symbolout_mlbloc(dst, valint);
-      fprintf(dst, "%x:", valint);
+  case ULAS_SYM_FMT_MLB: {
+    int offset = 0;
+    // only ints have a known memory type
+    const char *loc = ulas_symbolout_mlbloc(
+        val->type == ULAS_INT ? val->val.intv : -1, &offset);
+    ulas_fbufputs(fb, loc, strlen(loc));
+    switch (val->type) {
+    case ULAS_INT:
+      ulas_fbufhex(fb, (unsigned int)(val->val.intv - offset), 0, 0);
       break;
-    }
     case ULAS_STR:
-      ulas_symbolout_mlbloc(dst, -1);
-      fprintf(dst, "%s:", ulas_valstr(&s->tok, &rc));
+      ulas_fbufputs(fb, val->val.strv, strlen(val->val.strv));
       break;
     default:
-      ulas_symbolout_mlbloc(dst, -1);
-      fprintf(dst, "<Unknown type>:");
+      ulas_fbufputs(fb, ULAS_SYMUNKNOWNTYPE, strlen(ULAS_SYMUNKNOWNTYPE));
       break;
     }
-    if (!s->name || s->name[0] == '\0') {
-      fprintf(dst, "<unnamed>:<unnamed>");
+    ulas_fbufputc(fb, ':');
+    ulas_fbufputs(fb, name, namelen);
+    ulas_fbufputc(fb, ':');
+    ulas_fbufputs(fb, name, namelen);
+    break;
+  }
+  case ULAS_SYM_FMT_BIN:
+    // the binary database is written by ulas_symdbout
+    return;
+  }
+  ulas_fbufputc(fb, '\n');
+}
+
+// orders by type, value and name
+// which places duplicate entries next to each other
+int ulas_symbolkeycmp(unsigned long ia, unsigned long ib) {
+  const struct ulas_tok *ta = &ulas.syms.vals[ia];
+  const struct ulas_tok *tb = &ulas.syms.vals[ib];
+
+  if (ta->type != tb->type) {
+    return ta->type < tb->type ? -1 : 1;
+  }
+
+  if (ta->type == ULAS_INT && ta->val.intv != tb->val.intv) {
+    return (unsigned int)ta->val.intv < (unsigned int)tb->val.intv ? -1 : 1;
+  } else if (ta->type == ULAS_STR) {
+    int cmp = strcmp(ta->val.strv, tb->val.strv);
+    if (cmp) {
+      return cmp;
+    }
+  }
+
+  unsigned int na = ulas.syms.names[ia];
+  unsigned int nb = ulas.syms.names[ib];
+  if (na != nb) {
+    return na < nb ? -1 : 1;
+  }
+  return 0;
+}
+
+int ulas_symboloutcmp(const void *a, const void *b) {
+  unsigned long ia = *(const unsigned long *)a;
+  unsigned long ib = *(const unsigned long *)b;
+  int cmp = ulas_symbolkeycmp(ia, ib);
+  if (cmp) {
+    return cmp;
+  }
+  return ia < ib ? -1 : (ia > ib);
+}
+
+int ulas_symdbout(FILE *dst, const unsigned long *order, unsigned long len);
+
+int ulas_symbolout(FILE *dst) {
+  if (!dst) {
+    return 0;
+  }
+
+  struct ulas_symbuf *sb = &ulas.syms;
+  unsigned long *order = malloc(sizeof(unsigned long) * (sb->len + 1));
+  unsigned long len = 0;
+  for (unsigned long i = 0; i < sb->len; i++) {
+    if (!(sb->flags[i] & ULAS_SYMF_IMPORTED)) {
+      order[len++] = i;
+    }
+  }
+  qsort(order, len, sizeof(unsigned long), ulas_symboloutcmp);
+
+  // the same name and value may appear in multiple scopes
+  unsigned long unique = 0;
+  for (unsigned long i = 0; i < len; i++) {
+    if (unique > 0 && ulas_symbolkeycmp(order[unique - 1], order[i]) == 0) {
+      continue;
+    }
+    order[unique++] = order[i];
+  }
+  len = unique;
+
+  int rc = 0;
+  if (ulascfg.sym_fmt == ULAS_SYM_FMT_BIN) {
+    rc = ulas_symdbout(dst, order, len);
+  } else {
+    struct ulas_fbuf fb = ulas_fbuf(dst, ULAS_FBUFMAX);
+    for (unsigned long i = 0; i < len; i++) {
+      ulas_symbolfmt(&fb, order[i]);
+    }
+    ulas_fbuffree(&fb);
+  }
+
+  free(order);
+  return rc;
+}
+
+// defines an imported symbol unless the name is taken already
+// only named int symbols are imported
+// flags may only add ULAS_SYMF_LABEL
+void ulas_symbolimportset(const char *name, unsigned long n,
+                          struct ulas_tok tok, int flags) {
+  // scoped symbols are meaningless outside of their source file
+  if (n == 0 || name[0] == ULAS_TOK_SCOPED_SYMBOL_BEGIN ||
+      tok.type != ULAS_INT ||
+      (n == strlen(ULAS_SYMUNNAMED) &&
+       strncmp(name, ULAS_SYMUNNAMED, n) == 0)) {
+    ulas_tokfree(&tok);
+    return;
+  }
+
+  int rc = 0;
+  unsigned int atom = ulas_internpush(&ulas.atoms, name, n);
+  if (ulas_symbolresolve(atom, 0, &rc) != -1) {
+    ulas_tokfree(&tok);
+    return;
+  }
+
+  ulas_symbufpush(&ulas.syms, atom, tok, 0,
+                  ULAS_SYMF_CONSTANT | ULAS_SYMF_IMPORTED |
+                      (flags & ULAS_SYMF_LABEL));
+}
+
+int ulas_symdbimport(const char *path) {
+  struct ulas_symdb db;
+  if (ulas_symdbmap(&db, path) == -1) {
+    return -1;
+  }
+
+  for (uint32_t i = 0; i < db.header->entries_len; i++) {
+    const struct ulas_symdb_entry *e = &db.entries[i];
+    const char *name = ulas_symdbstr(&db, e->name);
+    struct ulas_tok tok = {ULAS_INT, {(int)e->val}};
+
+    // the database keeps the kind of each symbol
+    if (name && e->type == ULAS_INT) {
+      ulas_symbolimportset(name, strlen(name), tok, e->flags);
+    }
+  }
+
+  ulas_symdbclose(&db);
+  return 0;
+}
+
+int ulas_symbolimport(const char *path) {
+  FILE *f = fopen(path, "re");
+  if (!f) {
+    ULASERR("%s: %s\n", path, strerror(errno));
+    return -1;
+  }
+
+  char buf[ULAS_LINEMAX];
+  memset(buf, 0, ULAS_LINEMAX);
+
+  // binary databases are identified by their magic
+  if (fread(buf, 1, 4, f) == 4 && memcmp(buf, ULAS_SYMDB_MAGIC, 4) == 0) {
+    fclose(f);
+    return ulas_symdbimport(path);
+  }
+  rewind(f);
+
+  // name = 0x<int> or name = <str>
+  // string values are not imported
+  const char *sep = " = ";
+  while (fgets(buf, ULAS_LINEMAX, f) != NULL) {
+    ulas_trimend('\n', buf, ULAS_LINEMAX);
+    char *val = strstr(buf, sep);
+    if (!val) {
+      continue;
+    }
+    unsigned long namelen = val - buf;
+    val += strlen(sep);
+
+    if (strncmp(val, "0x", 2) != 0) {
+      continue;
+    }
+
+    // the text format does not tell labels apart from constants
+    struct ulas_tok tok = {ULAS_INT, {(int)strtoul(val, NULL, 16)}};
+    ulas_symbolimportset(buf, namelen, tok, 0);
+  }
+
+  fclose(f);
+  return 0;
+}
+
+/**
+ * Binary symbol database
+ */
+
+// appends n bytes to the string pool of a database image
+uint32_t ulas_symdbpush(struct ulas_str *pool, unsigned long *len,
+                        const char *s, unsigned long n) {
+  ulas_strensr(pool, *len + n + 1);
+  uint32_t offset = (uint32_t)*len;
+  memcpy(pool->buf + *len, s, n);
+  pool->buf[*len + n] = '\0';
+  *len += n + 1;
+  return offset;
+}
+
+int ulas_symdbout(FILE *dst, const unsigned long *order, unsigned long len) {
+  struct ulas_symbuf *sb = &ulas.syms;
+  struct ulas_symdb_header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, ULAS_SYMDB_MAGIC, 4);
+  header.version = ULAS_SYMDB_VERSION;
+  header.entries_len = (uint32_t)len;
+
+  // labels first so they form the address index
+  // order is sorted by value, which is kept within each part
+  unsigned long *sorted = malloc(sizeof(unsigned long) * (len + 1));
+  for (unsigned long i = 0; i < len; i++) {
+    if (sb->flags[order[i]] & ULAS_SYMF_LABEL) {
+      sorted[header.labels_len++] = order[i];
+    }
+  }
+  for (unsigned long i = 0, j = header.labels_len; i < len; i++) {
+    if (!(sb->flags[order[i]] & ULAS_SYMF_LABEL)) {
+      sorted[j++] = order[i];
+    }
+  }
+
+  header.hash_len = 1;
+  while (header.hash_len < len * 2) {
+    header.hash_len *= 2;
+  }
+
+  struct ulas_symdb_entry *entries =
+      calloc(len + 1, sizeof(struct ulas_symdb_entry));
+  uint32_t *hash = calloc(header.hash_len, sizeof(uint32_t));
+  // atom -> string pool offset + 1
+  // names are only stored once
+  uint32_t *names = calloc(ulas.atoms.len, sizeof(uint32_t));
+  struct ulas_str pool = ulas_str(ULAS_SYMNAMEMAX);
+  unsigned long poollen = 0;
+
+  for (unsigned long i = 0; i < len; i++) {
+    unsigned long si = sorted[i];
+    struct ulas_symdb_entry *e = &entries[i];
+    const char *name = ulas_internstr(&ulas.atoms, sb->names[si]);
+    unsigned long namelen = strlen(name);
+
+    if (!names[sb->names[si]]) {
+      names[sb->names[si]] = ulas_symdbpush(&pool, &poollen, name, namelen) + 1;
+    }
+    e->name = names[sb->names[si]] - 1;
+    e->hash = ulas_internhash(name, namelen);
+    e->type = (uint16_t)sb->vals[si].type;
+    e->flags = (uint16_t)sb->flags[si];
+
+    if (sb->vals[si].type == ULAS_STR) {
+      const char *str = sb->vals[si].val.strv;
+      e->val = ulas_symdbpush(&pool, &poollen, str, strlen(str));
     } else {
-      fprintf(dst, "%s:%s", s->name, s->name);
+      e->val = (uint32_t)sb->vals[si].val.intv;
     }
 
-    fprintf(dst, "\n");
-    break;
+    // the first entry of a name wins
+    uint32_t slot = e->hash & (header.hash_len - 1);
+    while (hash[slot]) {
+      slot = (slot + 1) & (header.hash_len - 1);
+    }
+    hash[slot] = (uint32_t)i + 1;
+  }
+
+  header.entries_off = sizeof(header);
+  header.hash_off =
+      header.entries_off + len * sizeof(struct ulas_symdb_entry);
+  header.strs_off = header.hash_off + header.hash_len * sizeof(uint32_t);
+  header.strs_len = (uint32_t)poollen;
+
+  int rc = 0;
+  if (fwrite(&header, sizeof(header), 1, dst) != 1 ||
+      fwrite(entries, sizeof(struct ulas_symdb_entry), len, dst) != len ||
+      fwrite(hash, sizeof(uint32_t), header.hash_len, dst) != header.hash_len ||
+      fwrite(pool.buf, 1, poollen, dst) != poollen || fflush(dst) == EOF) {
+    ULASERR("Unable to write symbol database: %s\n", strerror(errno));
+    rc = -1;
   }
 
+  ulas_strfree(&pool);
+  free(names);
+  free(hash);
+  free(entries);
+  free(sorted);
   return rc;
 }
 
+int ulas_symdbopen(struct ulas_symdb *db, const void *buf, unsigned long len) {
+  memset(db, 0, sizeof(*db));
+  const struct ulas_symdb_header *header = buf;
+
+  if (len < sizeof(*header) ||
+      memcmp(header->magic, ULAS_SYMDB_MAGIC, 4) != 0 ||
+      header->version != ULAS_SYMDB_VERSION) {
+    return -1;
+  }
+
+  // make sure every table is in bounds
+  unsigned long entries_end =
+      header->entries_off +
+      (unsigned long)header->entries_len * sizeof(struct ulas_symdb_entry);
+  unsigned long hash_end =
+      header->hash_off + (unsigned long)header->hash_len * sizeof(uint32_t);
+  unsigned long strs_end = header->strs_off + (unsigned long)header->strs_len;
+  if (entries_end > len || hash_end > len || strs_end > len ||
+      header->labels_len > header->entries_len || header->hash_len == 0 ||
+      (header->hash_len & (header->hash_len - 1)) != 0 ||
+      header->entries_off % 4 != 0 || header->hash_off % 4 != 0) {
+    return -1;
+  }
+
+  // the last string has to be terminated
+  if (header->strs_len && ((const char *)buf)[strs_end - 1] != '\0') {
+    return -1;
+  }
+
+  db->buf = buf;
+  db->len = len;
+  db->header = header;
+  db->entries =
+      (const struct ulas_symdb_entry *)(db->buf + header->entries_off);
+  db->hash = (const uint32_t *)(db->buf + header->hash_off);
+  db->strs = db->buf + header->strs_off;
+  return 0;
+}
+
+int ulas_symdbmap(struct ulas_symdb *db, const char *path) {
+  memset(db, 0, sizeof(*db));
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    ULASERR("%s: %s\n", path, strerror(errno));
+    return -1;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == -1 || st.st_size == 0) {
+    ULASERR("%s: unable to read symbol database\n", path);
+    close(fd);
+    return -1;
+  }
+
+  void *buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (buf == MAP_FAILED) {
+    ULASERR("%s: %s\n", path, strerror(errno));
+    return -1;
+  }
+
+  if (ulas_symdbopen(db, buf, st.st_size) == -1) {
+    ULASERR("%s: not a symbol database\n", path);
+    munmap(buf, st.st_size);
+    return -1;
+  }
+  db->mapped = 1;
+
+  return 0;
+}
+
+void ulas_symdbclose(struct ulas_symdb *db) {
+  if (db->mapped) {
+    munmap((void *)db->buf, db->len);
+  }
+  memset(db, 0, sizeof(*db));
+}
+
+const char *ulas_symdbstr(const struct ulas_symdb *db, uint32_t offset) {
+  if (offset >= db->header->strs_len) {
+    return NULL;
+  }
+  return db->strs + offset;
+}
+
+long ulas_symdbfind(const struct ulas_symdb *db, const char *name,
+                    unsigned long n) {
+  n = strnlen(name, n);
+  uint32_t h = ulas_internhash(name, n);
+  uint32_t mask = db->header->hash_len - 1;
+
+  for (uint32_t i = 0, slot = h & mask; i < db->header->hash_len;
+       i++, slot = (slot + 1) & mask) {
+    uint32_t entry = db->hash[slot];
+    if (!entry) {
+      break;
+    }
+    if (entry > db->header->entries_len) {
+      return -1;
+    }
+
+    const struct ulas_symdb_entry *e = &db->entries[entry - 1];
+    const char *other = ulas_symdbstr(db, e->name);
+    if (e->hash == h && other && strncmp(other, name, n) == 0 &&
+        other[n] == '\0') {
+      return entry - 1;
+    }
+  }
+
+  return -1;
+}
+
+long ulas_symdbnearest(const struct ulas_symdb *db, unsigned int addr) {
+  // first label that is > addr
+  unsigned long lo = 0;
+  unsigned long hi = db->header->labels_len;
+  while (lo < hi) {
+    unsigned long mid = lo + (hi - lo) / 2;
+    if (db->entries[mid].val <= addr) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  if (lo == 0) {
+    return -1;
+  }
+
+  // walk back to the first entry at the same address
+  unsigned long found = lo - 1;
+  while (found > 0 && db->entries[found - 1].val == db->entries[found].val) {
+    found--;
+  }
+
+  return (long)found;
+}
+
 #define ULAS_TOKISTERM write
 #define ULAS_TOKCOND (i < n && write < n && line[i])
 
@@ -548,7 +1112,8 @@ int ulas_tokuntil(struct ulas_str *dst, char c, const char **out_line,
   return i;
 }
 
-int ulas_unescape(char c, int *rc) {
+// returns the char of an escape sequence or -1
+int ulas_escchr(char c) {
   switch (c) {
   case '\'':
   case '\\':
@@ -569,12 +1134,21 @@ int ulas_unescape(char c, int *rc) {
   case '0':
     return '\0';
   default:
+    break;
+  }
+
+  return -1;
+}
+
+int ulas_unescape(char c, int *rc) {
+  int res = ulas_escchr(c);
+  if (res == -1) {
     ULASERR("Unexpected esxcape sequence: \\%c\n", c);
     *rc = -1;
-    break;
+    return '\0';
   }
 
-  return '\0';
+  return res;
 }
 
 struct ulas_tok ulas_totok(char *buf, unsigned long n, int *rc) {
@@ -685,7 +1259,7 @@ struct ulas_tok ulas_totok(char *buf, unsigned long n, int *rc) {
         // literal token
         // we resolve it later, will need to malloc here for now
         tok.type = ULAS_SYMBOL;
-        tok.val.strv = strndup(buf - 1, n);
+        tok.val.atom = ulas_internpush(&ulas.atoms, buf - 1, n);
         buf += n - 1;
       } else {
         ULASERR("Unexpected token: %s\n", buf);
@@ -736,38 +1310,115 @@ void ulas_strfree(struct ulas_str *s) {
   }
 }
 
-struct ulas_ppdef *ulas_preprocgetdef(struct ulas_preproc *pp, const char *name,
-                                      unsigned long maxlen) {
-  for (unsigned long i = 0; i < pp->defslen; i++) {
-    struct ulas_ppdef *def = &pp->defs[i];
-    if (!def->undef && strncmp(def->name, name, maxlen) == 0) {
-      return def;
-    }
+struct ulas_fbuf ulas_fbuf(FILE *dst, unsigned long maxlen) {
+  struct ulas_fbuf fb = {dst, malloc(maxlen), 0, maxlen};
+  if (!fb.buf) {
+    ULASPANIC("%s\n", strerror(errno));
   }
-
-  return NULL;
+  return fb;
 }
 
-// inserts all leading white space from praw_line into linebuf
-int ulas_preproclws(struct ulas_preproc *pp, const char *praw_line,
-                    unsigned long maxlen) {
-  int i = 0;
-  while (i < maxlen && praw_line[i] && isspace(praw_line[i])) {
-    i++;
+void ulas_fbufflush(struct ulas_fbuf *fb) {
+  if (fb->len && fb->dst) {
+    fwrite(fb->buf, 1, fb->len, fb->dst);
   }
-
-  ulas_strreq(&pp->line, i + 1);
-  strncat(pp->line.buf, praw_line, i);
-  return i;
+  fb->len = 0;
 }
 
-void ulas_trimend(char c, char *buf, unsigned long n) {
-  unsigned long buflen = strnlen(buf, n);
-  if (buflen == 0) {
+void ulas_fbufputs(struct ulas_fbuf *fb, const char *s, unsigned long n) {
+  if (fb->len + n > fb->maxlen) {
+    ulas_fbufflush(fb);
+  }
+
+  // too large for the buffer, write it directly
+  if (n > fb->maxlen) {
+    if (fb->dst) {
+      fwrite(s, 1, n, fb->dst);
+    }
     return;
   }
-  // remove trailing new line if present
-  while (buf[buflen - 1] == '\n') {
+
+  memcpy(fb->buf + fb->len, s, n);
+  fb->len += n;
+}
+
+void ulas_fbufputc(struct ulas_fbuf *fb, char c) {
+  if (fb->len >= fb->maxlen) {
+    ulas_fbufflush(fb);
+  }
+  fb->buf[fb->len++] = c;
+}
+
+void ulas_fbufhex(struct ulas_fbuf *fb, unsigned int v, int width, int upper) {
+  const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  char tmp[sizeof(unsigned int) * 2];
+  int len = 0;
+
+  do {
+    tmp[sizeof(tmp) - 1 - len++] = digits[v & 0xF];
+    v >>= 4;
+  } while (v);
+
+  while (len < width && len < (int)sizeof(tmp)) {
+    tmp[sizeof(tmp) - 1 - len++] = '0';
+  }
+
+  ulas_fbufputs(fb, tmp + sizeof(tmp) - len, len);
+}
+
+void ulas_fbufdec(struct ulas_fbuf *fb, unsigned long v, int width) {
+  char tmp[sizeof(unsigned long) * 3];
+  int len = 0;
+
+  do {
+    tmp[sizeof(tmp) - 1 - len++] = (char)('0' + v % 10);
+    v /= 10;
+  } while (v);
+
+  while (len < width && len < (int)sizeof(tmp)) {
+    tmp[sizeof(tmp) - 1 - len++] = '0';
+  }
+
+  ulas_fbufputs(fb, tmp + sizeof(tmp) - len, len);
+}
+
+void ulas_fbuffree(struct ulas_fbuf *fb) {
+  ulas_fbufflush(fb);
+  free(fb->buf);
+}
+
+struct ulas_ppdef *ulas_preprocgetdef(struct ulas_preproc *pp,
+                                      unsigned int name) {
+  if (!name) {
+    return NULL;
+  }
+
+  for (unsigned long i = 0; i < pp->defslen; i++) {
+    struct ulas_ppdef *def = &pp->defs[i];
+    if (!def->undef && def->name == name) {
+      return def;
+    }
+  }
+
+  return NULL;
+}
+
+// inserts all leading white space from praw_line into linebuf
+int ulas_preproclws(struct ulas_preproc *pp, const char *praw_line,
+                    unsigned long maxlen) {
+  int i = 0;
+  while (i < maxlen && praw_line[i] && isspace(praw_line[i])) {
+    i++;
+  }
+
+  ulas_strreq(&pp->line, i + 1);
+  strncat(pp->line.buf, praw_line, i);
+  return i;
+}
+
+void ulas_trimend(char c, char *buf, unsigned long n) {
+  unsigned long buflen = strnlen(buf, n);
+  while (buflen > 0 && buf[buflen - 1] == c) {
     buf[buflen - 1] = '\0';
     buflen--;
   }
@@ -788,8 +1439,9 @@ char *ulas_preprocexpand(struct ulas_preproc *pp, const char *raw_line,
   // only expand macros if they match toks[0] though!
   // otherwise memcpy the read bytes 1:1 into the new string
   while ((read = ulas_tok(&pp->tok, &praw_line, *n))) {
-    struct ulas_ppdef *def =
-        ulas_preprocgetdef(pp, pp->tok.buf, pp->tok.maxlen);
+    // a token that was never interned cannot name a define
+    struct ulas_ppdef *def = ulas_preprocgetdef(
+        pp, ulas_internfind(&ulas.atoms, pp->tok.buf, pp->tok.maxlen));
 
     // if it is the first token, and it begins with a # do not process at all!
     // if the first token is a # preproc directive skip the second token at all
@@ -968,15 +1620,6 @@ int ulas_preprocline(struct ulas_preproc *pp, FILE *dst, FILE *src,
   char *line = ulas_preprocexpand(pp, raw_line, &n);
   const char *pline = line;
 
-  const char *dirstrs[] = {
-      ULAS_PPSTR_DEF,    ULAS_PPSTR_MACRO,   ULAS_PPSTR_IFDEF,
-      ULAS_PPSTR_IFNDEF, ULAS_PPSTR_ENDIF,   ULAS_PPSTR_ENDMACRO,
-      ULAS_PPSTR_UNDEF,  ULAS_PPSTR_INCLUDE, NULL};
-  enum ulas_ppdirs dirs[] = {ULAS_PPDIR_DEF,   ULAS_PPDIR_MACRO,
-                             ULAS_PPDIR_IFDEF, ULAS_PPDIR_IFNDEF,
-                             ULAS_PPDIR_ENDIF, ULAS_PPDIR_ENDMACRO,
-                             ULAS_PPDIR_UNDEF, ULAS_PPDIR_INCLUDE};
-
   enum ulas_ppdirs found_dir = ULAS_PPDIR_NONE;
 
   // check if the first token is any of the valid preproc directives
@@ -985,11 +1628,11 @@ int ulas_preprocline(struct ulas_preproc *pp, FILE *dst, FILE *src,
     if (pp->tok.buf[0] != ULAS_TOK_PREPROC_BEGIN) {
       goto found;
     }
-    for (unsigned long i = 0; dirstrs[i]; i++) {
-      if (strncmp(dirstrs[i], pp->tok.buf, pp->tok.maxlen) == 0) {
-        found_dir = dirs[i];
-        goto found;
-      }
+    const struct ulas_keyword *kw = ulas_arch_keyword(
+        pp->tok.buf, strnlen(pp->tok.buf, pp->tok.maxlen));
+    if (kw && kw->kind == ULAS_KW_PPDIR) {
+      found_dir = (enum ulas_ppdirs)kw->value;
+      goto found;
     }
 
     ULASPANIC("Unknown preprocessor directive: %s\n", line);
@@ -1013,8 +1656,10 @@ found:
         return -1;
       }
 
-      struct ulas_ppdef def = {ULAS_PPDEF, strdup(pp->tok.buf), strdup(pline),
-                               0};
+      struct ulas_ppdef def = {
+          ULAS_PPDEF,
+          ulas_internpush(&ulas.atoms, pp->tok.buf, pp->tok.maxlen),
+          strdup(pline), 0};
       ulas_preprocdef(pp, def);
       // define short-circuits the rest of the logic
       // because it just takes the entire rest of the line as a value!
@@ -1032,7 +1677,8 @@ found:
         ULASERR("'%s' is not a valid #macro name!\n", pp->tok.buf);
         return -1;
       }
-      char *name = strdup(pp->tok.buf);
+      unsigned int name =
+          ulas_internpush(&ulas.atoms, pp->tok.buf, pp->tok.maxlen);
 
       struct ulas_str val = ulas_str(32);
       memset(val.buf, 0, 32);
@@ -1061,7 +1707,6 @@ found:
       if (rc != ULAS_PPDIR_ENDMACRO) {
         ULASERR("Unterminated macro directive\n");
         ulas_strfree(&val);
-        free(name);
         return -1;
       }
       // we leak the str's buffer into the def now
@@ -1083,8 +1728,8 @@ found:
         ULASERR("Expected name for #if(n)def\n");
         return -1;
       }
-      struct ulas_ppdef *def =
-          ulas_preprocgetdef(pp, pp->tok.buf, pp->tok.maxlen);
+      struct ulas_ppdef *def = ulas_preprocgetdef(
+          pp, ulas_internfind(&ulas.atoms, pp->tok.buf, pp->tok.maxlen));
 
       char buf[ULAS_LINEMAX];
       memset(buf, 0, ULAS_LINEMAX);
@@ -1117,7 +1762,9 @@ found:
         return -1;
       }
       struct ulas_ppdef *def = NULL;
-      while ((def = ulas_preprocgetdef(pp, pp->tok.buf, pp->tok.maxlen))) {
+      unsigned int name =
+          ulas_internfind(&ulas.atoms, pp->tok.buf, pp->tok.maxlen);
+      while ((def = ulas_preprocgetdef(pp, name))) {
         def->undef = 1;
       }
 
@@ -1195,9 +1842,6 @@ struct ulas_preproc ulas_preprocinit(void) {
 
 void ulas_preprocclear(struct ulas_preproc *pp) {
   for (unsigned long i = 0; i < pp->defslen; i++) {
-    if (pp->defs[i].name) {
-      free(pp->defs[i].name);
-    }
     if (pp->defs[i].value) {
       free(pp->defs[i].value);
     }
@@ -1239,7 +1883,7 @@ int ulas_preproc(FILE *dst, FILE *src) {
     // after each preproc line we assembly it by reading it back
     // from the temporary buffer
     fseek(asmsrc, prevseek, SEEK_SET);
-    if (ulas_asm(ulasout, asmsrc) == -1) {
+    if (ulas_asm(ulassink, asmsrc) == -1) {
       rc = -1;
       goto fail;
     }
@@ -1260,13 +1904,20 @@ int ulas_valint(struct ulas_tok *lit, int *rc) {
   }
 
   if (lit->type == ULAS_SYMBOL) {
-    struct ulas_sym *stok = ulas_symbolresolve(lit->val.strv, ulas.scope, rc);
-    if (!stok || *rc == -1) {
-      ULASERR("Unabel to resolve '%s'\n", lit->val.strv);
+    for (struct ulas_repvar *v = ulas.repvar; v; v = v->prev) {
+      if (v->atom == lit->val.atom) {
+        return v->val;
+      }
+    }
+
+    long stok = ulas_symbolresolve(lit->val.atom, ulas.scope, rc);
+    if (stok == -1 || *rc == -1) {
+      ULASERR("Unabel to resolve '%s'\n",
+              ulas_internstr(&ulas.atoms, lit->val.atom));
       *rc = -1;
       return 0;
     }
-    return ulas_valint(&stok->tok, rc);
+    return ulas_valint(&ulas.syms.vals[stok], rc);
   }
 
   if (!lit || (lit->type != ULAS_INT && lit->type != ULAS_TOK_CURRENT_ADDR)) {
@@ -1327,7 +1978,7 @@ int ulas_tokbufpush(struct ulas_tokbuf *tb, struct ulas_tok tok) {
 }
 
 void ulas_tokfree(struct ulas_tok *t) {
-  if (t->type == ULAS_SYMBOL || t->type == ULAS_STR) {
+  if (t->type == ULAS_STR) {
     free(t->val.strv);
   }
 }
@@ -1345,6 +1996,43 @@ void ulas_tokbuffree(struct ulas_tokbuf *tb) {
   free(tb->buf);
 }
 
+struct ulas_opbuf ulas_opbuf(void) {
+  struct ulas_opbuf ob;
+  memset(&ob, 0, sizeof(ob));
+
+  ob.maxlen = 8;
+  ob.buf = malloc(ob.maxlen * sizeof(struct ulas_optok));
+
+  return ob;
+}
+
+struct ulas_optok *ulas_opbufget(struct ulas_opbuf *ob, unsigned long i) {
+  if (i >= ob->len) {
+    return NULL;
+  }
+
+  return &ob->buf[i];
+}
+
+long ulas_opbufpush(struct ulas_opbuf *ob, struct ulas_optok tok) {
+  if (ob->len >= ob->maxlen) {
+    ob->maxlen *= 2;
+    void *n = realloc(ob->buf, ob->maxlen * sizeof(struct ulas_optok));
+    if (!n) {
+      ULASPANIC("%s\n", strerror(errno));
+    }
+
+    ob->buf = n;
+  }
+
+  ob->buf[ob->len] = tok;
+  return (long)ob->len++;
+}
+
+void ulas_opbufclear(struct ulas_opbuf *ob) { ob->len = 0; }
+
+void ulas_opbuffree(struct ulas_opbuf *ob) { free(ob->buf); }
+
 struct ulas_exprbuf ulas_exprbuf(void) {
   struct ulas_exprbuf eb;
   memset(&eb, 0, sizeof(eb));
@@ -1386,629 +2074,1774 @@ struct ulas_symbuf ulas_symbuf(void) {
   memset(&sb, 0, sizeof(sb));
 
   sb.maxlen = 10;
-  sb.buf = malloc(sizeof(struct ulas_sym) * sb.maxlen);
+  sb.names = malloc(sizeof(unsigned int) * sb.maxlen);
+  sb.vals = malloc(sizeof(struct ulas_tok) * sb.maxlen);
+  sb.scopes = malloc(sizeof(int) * sb.maxlen);
+  sb.flags = malloc(sizeof(int) * sb.maxlen);
 
   return sb;
 }
 
-int ulas_symbufpush(struct ulas_symbuf *sb, struct ulas_sym sym) {
+void *ulas_symbufgrow(void *buf, unsigned long size) {
+  void *newbuf = realloc(buf, size);
+  if (!newbuf) {
+    ULASPANIC("%s\n", strerror(errno));
+  }
+  return newbuf;
+}
+
+long ulas_symbufpush(struct ulas_symbuf *sb, unsigned int name,
+                     struct ulas_tok val, int scope, int flags) {
   if (sb->len >= sb->maxlen) {
     sb->maxlen *= 2;
-    void *newbuf = realloc(sb->buf, sb->maxlen * sizeof(struct ulas_sym));
-    if (!newbuf) {
-      ULASPANIC("%s\n", strerror(errno));
-    }
-    sb->buf = newbuf;
+    sb->names = ulas_symbufgrow(sb->names, sb->maxlen * sizeof(unsigned int));
+    sb->vals = ulas_symbufgrow(sb->vals, sb->maxlen * sizeof(struct ulas_tok));
+    sb->scopes = ulas_symbufgrow(sb->scopes, sb->maxlen * sizeof(int));
+    sb->flags = ulas_symbufgrow(sb->flags, sb->maxlen * sizeof(int));
   }
 
-  sb->buf[sb->len] = sym;
-  return (int)sb->len++;
+  sb->names[sb->len] = name;
+  sb->vals[sb->len] = val;
+  sb->scopes[sb->len] = scope;
+  sb->flags[sb->len] = flags;
+  return (long)sb->len++;
 }
 
-struct ulas_sym *ulas_symbufget(struct ulas_symbuf *sb, int i) {
-  if (i >= sb->len) {
-    return NULL;
+int ulas_symbufaddrcmp(const void *a, const void *b) {
+  unsigned long ia = *(const unsigned long *)a;
+  unsigned long ib = *(const unsigned long *)b;
+  unsigned int va = (unsigned int)ulas.syms.vals[ia].val.intv;
+  unsigned int vb = (unsigned int)ulas.syms.vals[ib].val.intv;
+
+  if (va != vb) {
+    return va < vb ? -1 : 1;
+  }
+  // keep definition order for labels at the same address
+  return ia < ib ? -1 : (ia > ib);
+}
+
+void ulas_symbufsort(struct ulas_symbuf *sb) {
+  free(sb->addrs);
+  sb->addrs = malloc(sizeof(unsigned long) * (sb->len + 1));
+  sb->addrslen = 0;
+
+  for (unsigned long i = 0; i < sb->len; i++) {
+    if (sb->vals[i].type == ULAS_INT && (sb->flags[i] & ULAS_SYMF_LABEL)) {
+      sb->addrs[sb->addrslen++] = i;
+    }
   }
 
-  return &sb->buf[i];
+  // the compare function reads from the global symbol buffer
+  assert(sb == &ulas.syms);
+  qsort(sb->addrs, sb->addrslen, sizeof(unsigned long), ulas_symbufaddrcmp);
 }
 
 void ulas_symbufclear(struct ulas_symbuf *sb) {
-  for (long i = 0; i < sb->len; i++) {
-    struct ulas_sym *s = &sb->buf[i];
-    free(s->name);
+  for (unsigned long i = 0; i < sb->len; i++) {
+    ulas_tokfree(&sb->vals[i]);
   }
   sb->len = 0;
+  sb->addrslen = 0;
 }
 
 void ulas_symbuffree(struct ulas_symbuf *sb) {
   ulas_symbufclear(sb);
-  free(sb->buf);
+  free(sb->names);
+  free(sb->vals);
+  free(sb->scopes);
+  free(sb->flags);
+  free(sb->addrs);
 }
 
-/**
- * Assembly step
- */
+// fnv-1a
+unsigned int ulas_internhash(const char *s, unsigned long n) {
+  uint32_t h = 2166136261U;
+  for (unsigned long i = 0; i < n; i++) {
+    h ^= (unsigned char)s[i];
+    h *= 16777619U;
+  }
+  return h;
+}
 
-int ulas_istokend(struct ulas_str *tok) {
-  long len = (int)strnlen(tok->buf, tok->maxlen);
-  // skip comments though, they are not trailing tokens!
-  if (len > 0 && tok->buf[0] != ULAS_TOK_COMMENT) {
-    return 0;
+// returns the table slot of s
+// the slot is either empty or holds s' atom
+unsigned long ulas_internslot(struct ulas_intern *in, const char *s,
+                              unsigned long n) {
+  unsigned long mask = in->tablelen - 1;
+  unsigned long i = ulas_internhash(s, n) & mask;
+
+  while (in->table[i]) {
+    const char *other = in->strs[in->table[i]];
+    if (strncmp(other, s, n) == 0 && other[n] == '\0') {
+      break;
+    }
+    i = (i + 1) & mask;
   }
 
-  return 1;
+  return i;
 }
 
-// tokenize all until a terminator token or comment is reached
-int ulas_tokexpr(const char **line, unsigned long n) {
-  ulas_tokbufclear(&ulas.toks);
+struct ulas_intern ulas_intern(void) {
+  struct ulas_intern in;
+  memset(&in, 0, sizeof(in));
 
-  int tokrc = 0;
-  while ((tokrc = ulas_tok(&ulas.tok, line, n) > 0)) {
-    if (tokrc == -1) {
-      goto end;
-    }
+  in.maxlen = 64;
+  in.strs = malloc(sizeof(char *) * in.maxlen);
+  // atom 0 is reserved
+  in.strs[0] = NULL;
+  in.len = 1;
 
-    // empty tokens are going to be ignored
-    if (strnlen(ulas.tok.buf, ulas.tok.maxlen) == 0) {
-      continue;
-    }
+  in.tablelen = 128;
+  in.table = calloc(in.tablelen, sizeof(unsigned int));
 
-    // interpret the token
-    struct ulas_tok tok = ulas_totok(
-        ulas.tok.buf, strnlen(ulas.tok.buf, ulas.tok.maxlen), &tokrc);
-    if (tokrc == -1) {
-      goto end;
-    }
+  return in;
+}
 
-    // check for any expression terminators here
-    if (tok.type == ',' || tok.type == ']' || tok.type == '=' ||
-        ulas_istokend(&ulas.tok)) {
-      // on terminator we roll back line so that the terminator token
-      // is not consumed now
-      *line -= tokrc;
-      goto end;
+unsigned int ulas_internpush(struct ulas_intern *in, const char *s,
+                             unsigned long n) {
+  n = strnlen(s, n);
+  unsigned long slot = ulas_internslot(in, s, n);
+  if (in->table[slot]) {
+    return in->table[slot];
+  }
+
+  if (in->len >= in->maxlen) {
+    in->maxlen *= 2;
+    void *newbuf = realloc(in->strs, in->maxlen * sizeof(char *));
+    if (!newbuf) {
+      ULASPANIC("%s\n", strerror(errno));
     }
+    in->strs = newbuf;
+  }
 
-    // now we can loop token type, add all tokens to the token buffer
-    ulas_tokbufpush(&ulas.toks, tok);
+  unsigned int atom = (unsigned int)in->len++;
+  in->strs[atom] = strndup(s, n);
+  in->table[slot] = atom;
+
+  // keep the load factor below 1/2
+  if (in->len * 2 > in->tablelen) {
+    free(in->table);
+    in->tablelen *= 2;
+    in->table = calloc(in->tablelen, sizeof(unsigned int));
+    if (!in->table) {
+      ULASPANIC("%s\n", strerror(errno));
+    }
+    for (unsigned int i = 1; i < in->len; i++) {
+      const char *str = in->strs[i];
+      in->table[ulas_internslot(in, str, strlen(str))] = i;
+    }
   }
 
-end:
-  return tokrc;
+  return atom;
 }
 
-/**
- * Parse expressions from tokens
- * return tree-like structure
- * all these functions return an int index into
- * the expression buffer.
- * they also all take an index variable i which can be freely modified.
- * i may never exceed toks->len.
- * if i is not the same as toks->len when the parser finishes
- * we error out because of trailing tokens!
- */
+unsigned int ulas_internfind(struct ulas_intern *in, const char *s,
+                             unsigned long n) {
+  n = strnlen(s, n);
+  return in->table[ulas_internslot(in, s, n)];
+}
 
-int ulas_parseexprat(int *i);
+const char *ulas_internstr(struct ulas_intern *in, unsigned int atom) {
+  if (atom == 0 || atom >= in->len) {
+    return NULL;
+  }
+  return in->strs[atom];
+}
 
-int ulas_parseprim(int *i) {
-  struct ulas_tok *t = ulas_tokbufget(&ulas.toks, *i);
-  if (!t ||
-      (t->type != ULAS_INT && t->type != ULAS_STR && t->type != ULAS_SYMBOL &&
-       t->type != ULAS_TOK_CURRENT_ADDR && t->type != '(' && t->type != ')')) {
-    ULASERR("Primary expression expected\n");
-    return -1;
+void ulas_internfree(struct ulas_intern *in) {
+  for (unsigned long i = 1; i < in->len; i++) {
+    free(in->strs[i]);
   }
+  free(in->strs);
+  free(in->table);
+}
 
-  if (t->type == '(') {
-    *i += 1;
-    int head = ulas_parseexprat(i);
+struct ulas_linecache ulas_linecache(void) {
+  struct ulas_linecache lc;
+  memset(&lc, 0, sizeof(lc));
 
-    struct ulas_expgrp grp = {head};
-    union ulas_expval val = {.grp = grp};
-    struct ulas_expr e = {ULAS_EXPGRP, val};
+  lc.lines = ulas_intern();
 
-    struct ulas_tok *closing = ulas_tokbufget(&ulas.toks, *i);
-    if (!closing || closing->type != ')') {
-      ULASERR("Unterminated group expression\n");
-      return -1;
-    }
-    *i += 1;
-    return ulas_exprbufpush(&ulas.exprs, e);
-  } else {
-    struct ulas_expprim prim = {*i};
-    union ulas_expval val = {.prim = prim};
-    struct ulas_expr e = {ULAS_EXPPRIM, val};
-    *i += 1;
-    return ulas_exprbufpush(&ulas.exprs, e);
-  }
+  return lc;
 }
 
-int ulas_parsecmp(int *i);
+int ulas_linecachekey(struct ulas_linecache *lc, const char *line,
+                      unsigned long n, const char **end) {
+  unsigned long len = 0;
+  unsigned long i = 0;
+  int space = 0;
 
-int ulas_parseun(int *i) {
-  struct ulas_tok *t = ulas_tokbufget(&ulas.toks, *i);
+  while (i < n && line[i] && line[i] != ULAS_TOK_COMMENT && line[i] != '\n') {
+    char c = line[i++];
+    // strings and chars may contain the comment character
+    if (c == '"' || c == '\'') {
+      return 0;
+    }
 
-  if (t &&
-      (t->type == '!' || t->type == '-' || t->type == '~' || t->type == '+')) {
-    int op = *i;
-    *i += 1;
-    int right = ulas_parseun(i);
+    // collapse whitespace runs
+    if (isspace(c)) {
+      space = len > 0;
+      continue;
+    }
 
-    struct ulas_expun un = {right, op};
-    union ulas_expval val = {.un = un};
-    struct ulas_expr e = {ULAS_EXPUN, val};
-    return ulas_exprbufpush(&ulas.exprs, e);
+    if (len + 2 >= ULAS_LINECACHE_KEYMAX) {
+      return 0;
+    }
+    if (space) {
+      lc->key[len++] = ' ';
+      space = 0;
+    }
+    lc->key[len++] = c;
   }
 
-  return ulas_parseprim(i);
+  lc->key[len] = '\0';
+  lc->keylen = len;
+  *end = line + i;
+  return len > 0;
 }
 
-int ulas_parsefact(int *i) {
-  int expr = ulas_parseun(i);
-  struct ulas_tok *t = NULL;
-
-  while ((t = ulas_tokbufget(&ulas.toks, *i)) &&
-         (t->type == '*' || t->type == '/' || t->type == '%')) {
-    int op = *i;
-    *i += 1;
-    int right = ulas_parseun(i);
-
-    struct ulas_expbin bin = {expr, right, op};
-    union ulas_expval val = {.bin = bin};
-    struct ulas_expr e = {ULAS_EXPBIN, val};
-    expr = ulas_exprbufpush(&ulas.exprs, e);
+struct ulas_linecached *ulas_linecacheget(struct ulas_linecache *lc) {
+  unsigned int atom = ulas_internfind(&lc->lines, lc->key, lc->keylen);
+  if (atom >= lc->maxlen || lc->entries[atom].len == 0) {
+    return NULL;
   }
 
-  return expr;
+  return &lc->entries[atom];
 }
 
-int ulas_parseterm(int *i) {
-  int expr = ulas_parsefact(i);
-  struct ulas_tok *t = NULL;
-
-  while ((t = ulas_tokbufget(&ulas.toks, *i)) &&
-         (t->type == '+' || t->type == '-')) {
-    int op = *i;
-    *i += 1;
-    int right = ulas_parsefact(i);
+void ulas_linecacheput(struct ulas_linecache *lc, const char *bytes,
+                       unsigned long len, int final) {
+  if (len == 0 || len > ULAS_LINECACHE_BYTES ||
+      lc->lines.len >= ULAS_LINECACHEMAX) {
+    return;
+  }
 
-    struct ulas_expbin bin = {expr, right, op};
-    union ulas_expval val = {.bin = bin};
-    struct ulas_expr e = {ULAS_EXPBIN, val};
-    expr = ulas_exprbufpush(&ulas.exprs, e);
+  unsigned int atom = ulas_internpush(&lc->lines, lc->key, lc->keylen);
+  if (atom >= lc->maxlen) {
+    unsigned long maxlen = MAX(lc->lines.maxlen, atom + 1);
+    void *n = realloc(lc->entries, maxlen * sizeof(struct ulas_linecached));
+    if (!n) {
+      ULASPANIC("%s\n", strerror(errno));
+    }
+    lc->entries = n;
+    memset(lc->entries + lc->maxlen, 0,
+           (maxlen - lc->maxlen) * sizeof(struct ulas_linecached));
+    lc->maxlen = maxlen;
   }
 
-  return expr;
+  struct ulas_linecached *e = &lc->entries[atom];
+  memcpy(e->bytes, bytes, len);
+  e->len = (unsigned char)len;
+  e->final = (unsigned char)final;
 }
 
-int ulas_parseshift(int *i) {
-  int expr = ulas_parseterm(i);
-  struct ulas_tok *t = NULL;
+void ulas_linecachefree(struct ulas_linecache *lc) {
+  ulas_internfree(&lc->lines);
+  free(lc->entries);
+}
 
-  while ((t = ulas_tokbufget(&ulas.toks, *i)) &&
-         (t->type == ULAS_RSHIFT || t->type == ULAS_LSHIFT)) {
-    int op = *i;
-    *i += 1;
-    int right = ulas_parseterm(i);
+struct ulas_lstbuf ulas_lstbuf(void) {
+  struct ulas_lstbuf lb;
+  memset(&lb, 0, sizeof(lb));
 
-    struct ulas_expbin bin = {expr, right, op};
-    union ulas_expval val = {.bin = bin};
-    struct ulas_expr e = {ULAS_EXPBIN, val};
-    expr = ulas_exprbufpush(&ulas.exprs, e);
-  }
+  lb.maxlen = 64;
+  lb.buf = malloc(lb.maxlen * sizeof(struct ulas_lstrec));
+  lb.datamax = 4096;
+  lb.data = malloc(lb.datamax);
 
-  return expr;
+  return lb;
 }
 
-int ulas_parsecmp(int *i) {
-  int expr = ulas_parseshift(i);
+// appends n bytes to the record data and returns their offset
+unsigned long ulas_lstbufdata(struct ulas_lstbuf *lb, const char *s,
+                              unsigned long n) {
+  if (lb->datalen + n > lb->datamax) {
+    while (lb->datalen + n > lb->datamax) {
+      lb->datamax *= 2;
+    }
+    void *newdata = realloc(lb->data, lb->datamax);
+    if (!newdata) {
+      ULASPANIC("%s\n", strerror(errno));
+    }
+    lb->data = newdata;
+  }
+
+  unsigned long offset = lb->datalen;
+  memcpy(lb->data + offset, s, n);
+  lb->datalen += n;
+  return offset;
+}
+
+void ulas_lstbufpush(struct ulas_lstbuf *lb, const char *line,
+                     const char *outbuf, unsigned long n) {
+  if (lb->len >= lb->maxlen) {
+    lb->maxlen *= 2;
+    void *newbuf = realloc(lb->buf, lb->maxlen * sizeof(struct ulas_lstrec));
+    if (!newbuf) {
+      ULASPANIC("%s\n", strerror(errno));
+    }
+    lb->buf = newbuf;
+  }
+
+  struct ulas_lstrec *r = &lb->buf[lb->len++];
+  r->address = ulas.address;
+  r->file = ulas.filename ? ulas_internpush(&ulas.atoms, ulas.filename,
+                                            strlen(ulas.filename))
+                          : 0;
+  r->line = ulas.line;
+  r->byteslen = n;
+  r->bytes = ulas_lstbufdata(lb, outbuf, n);
+  r->srclen = strlen(line);
+  r->src = ulas_lstbufdata(lb, line, r->srclen);
+}
+
+void ulas_lstrender(struct ulas_lstbuf *lb, FILE *dst) {
+  const int pad = 10;
+  struct ulas_fbuf fb = ulas_fbuf(dst, ULAS_LSTBUFMAX);
+
+  for (unsigned long i = 0; dst && i < lb->len; i++) {
+    struct ulas_lstrec *r = &lb->buf[i];
+
+    ulas_fbufhex(&fb, r->address, 8, 1);
+    ulas_fbufputs(&fb, "  ", 2);
+
+    // always pad at least n bytes
+    const unsigned char *bytes = (const unsigned char *)lb->data + r->bytes;
+    int outwrt = 0;
+    for (unsigned long j = 0; j < r->byteslen; j++) {
+      ulas_fbufhex(&fb, bytes[j], 2, 0);
+      ulas_fbufputc(&fb, ' ');
+      outwrt += 3;
+    }
+    for (int j = outwrt; j < pad; j++) {
+      ulas_fbufputc(&fb, '.');
+    }
+
+    // atom 0 is input without a file name
+    const char *file = r->file ? ulas_internstr(&ulas.atoms, r->file) : NULL;
+    if (!file) {
+      file = "(null)";
+    }
+
+    ulas_fbufputs(&fb, "  (", 3);
+    ulas_fbufputs(&fb, file, strlen(file));
+    ulas_fbufputc(&fb, ':');
+    ulas_fbufdec(&fb, r->line, 4);
+    ulas_fbufputs(&fb, ") ", 2);
+    ulas_fbufputs(&fb, lb->data + r->src, r->srclen);
+  }
+
+  ulas_fbuffree(&fb);
+
+  lb->len = 0;
+  lb->datalen = 0;
+}
+
+void ulas_lstbuffree(struct ulas_lstbuf *lb) {
+  free(lb->buf);
+  free(lb->data);
+}
+
+char *ulas_freadall(FILE *f, unsigned long *len) {
+  unsigned long maxlen = ULAS_FBUFMAX;
+  char *buf = malloc(maxlen);
+  if (!buf) {
+    ULASPANIC("%s\n", strerror(errno));
+  }
+
+  *len = 0;
+  unsigned long read = 0;
+  while ((read = fread(buf + *len, 1, maxlen - *len, f)) > 0) {
+    *len += read;
+    if (*len < maxlen) {
+      continue;
+    }
+    maxlen *= 2;
+    void *newbuf = realloc(buf, maxlen);
+    if (!newbuf) {
+      ULASPANIC("%s\n", strerror(errno));
+    }
+    buf = newbuf;
+  }
+
+  if (ferror(f)) {
+    free(buf);
+    return NULL;
+  }
+  return buf;
+}
+
+struct ulas_incbinbuf ulas_incbinbuf(void) {
+  struct ulas_incbinbuf ib;
+  memset(&ib, 0, sizeof(ib));
+
+  ib.maxlen = 4;
+  ib.buf = malloc(ib.maxlen * sizeof(struct ulas_incbin));
+
+  return ib;
+}
+
+int ulas_incbinload(struct ulas_incbin *e, FILE *f, const char *path) {
+  // regular files are mapped, everything else is read
+  // empty files cannot be mapped
+  struct stat st;
+  void *buf = MAP_FAILED;
+  unsigned long len = 0;
+  int mapped = 0;
+  if (fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    len = st.st_size;
+    mapped = buf != MAP_FAILED;
+  }
+  if (!mapped) {
+    buf = ulas_freadall(f, &len);
+  }
+  if (!buf) {
+    ULASERR("%s: %s\n", path, strerror(errno));
+    return -1;
+  }
+
+  e->path = strdup(path);
+  e->buf = buf;
+  e->len = len;
+  e->mapped = mapped;
+
+  return 0;
+}
+
+void ulas_incbinfree(struct ulas_incbin *e) {
+  if (e->mapped) {
+    munmap((void *)e->buf, e->len);
+  } else {
+    free((void *)e->buf);
+  }
+  free(e->path);
+}
+
+const struct ulas_incbin *ulas_incbinget(struct ulas_incbinbuf *ib,
+                                         const char *path) {
+  for (unsigned long i = 0; i < ib->len; i++) {
+    if (strcmp(ib->buf[i].path, path) == 0) {
+      return &ib->buf[i];
+    }
+  }
+
+  FILE *f = ulas_incpathfopen(path, "re");
+  if (!f) {
+    return NULL;
+  }
+
+  if (ib->len >= ib->maxlen) {
+    ib->maxlen *= 2;
+    void *newbuf = realloc(ib->buf, ib->maxlen * sizeof(struct ulas_incbin));
+    if (!newbuf) {
+      ULASPANIC("%s\n", strerror(errno));
+    }
+    ib->buf = newbuf;
+  }
+
+  struct ulas_incbin *e = &ib->buf[ib->len];
+  int rc = ulas_incbinload(e, f, path);
+  fclose(f);
+  if (rc == -1) {
+    return NULL;
+  }
+  ib->len++;
+
+  return e;
+}
+
+void ulas_incbinbuffree(struct ulas_incbinbuf *ib) {
+  for (unsigned long i = 0; i < ib->len; i++) {
+    ulas_incbinfree(&ib->buf[i]);
+  }
+  free(ib->buf);
+}
+
+/**
+ * Assembly step
+ */
+
+int ulas_istokend(struct ulas_str *tok) {
+  long len = (int)strnlen(tok->buf, tok->maxlen);
+  // skip comments though, they are not trailing tokens!
+  if (len > 0 && tok->buf[0] != ULAS_TOK_COMMENT) {
+    return 0;
+  }
+
+  return 1;
+}
+
+int ulas_tokbufconst(struct ulas_tokbuf *tb) {
+  for (long i = 0; i < tb->len; i++) {
+    int type = (int)tb->buf[i].type;
+    if (type == ULAS_SYMBOL || type == ULAS_STR ||
+        type == ULAS_TOK_CURRENT_ADDR) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+// tokenize all until a terminator token or comment is reached
+int ulas_tokexpr(const char **line, unsigned long n) {
+  ulas_tokbufclear(&ulas.toks);
+
+  int tokrc = 0;
+  while ((tokrc = ulas_tok(&ulas.tok, line, n) > 0)) {
+    if (tokrc == -1) {
+      goto end;
+    }
+
+    // empty tokens are going to be ignored
+    if (strnlen(ulas.tok.buf, ulas.tok.maxlen) == 0) {
+      continue;
+    }
+
+    // interpret the token
+    struct ulas_tok tok = ulas_totok(
+        ulas.tok.buf, strnlen(ulas.tok.buf, ulas.tok.maxlen), &tokrc);
+    if (tokrc == -1) {
+      goto end;
+    }
+
+    // check for any expression terminators here
+    if (tok.type == ',' || tok.type == ']' || tok.type == '=' ||
+        ulas_istokend(&ulas.tok)) {
+      // on terminator we roll back line so that the terminator token
+      // is not consumed now
+      *line -= tokrc;
+      goto end;
+    }
+
+    // now we can loop token type, add all tokens to the token buffer
+    ulas_tokbufpush(&ulas.toks, tok);
+  }
+
+end:
+  return tokrc;
+}
+
+/**
+ * Parse expressions from tokens
+ * return tree-like structure
+ * all these functions return an int index into
+ * the expression buffer.
+ * they also all take an index variable i which can be freely modified.
+ * i may never exceed toks->len.
+ * if i is not the same as toks->len when the parser finishes
+ * we error out because of trailing tokens!
+ */
+
+int ulas_parseexprat(int *i);
+
+int ulas_parseprim(int *i) {
+  struct ulas_tok *t = ulas_tokbufget(&ulas.toks, *i);
+  if (!t ||
+      (t->type != ULAS_INT && t->type != ULAS_STR && t->type != ULAS_SYMBOL &&
+       t->type != ULAS_TOK_CURRENT_ADDR && t->type != '(' && t->type != ')')) {
+    ULASERR("Primary expression expected\n");
+    return -1;
+  }
+
+  if (t->type == '(') {
+    *i += 1;
+    int head = ulas_parseexprat(i);
+
+    struct ulas_expgrp grp = {head};
+    union ulas_expval val = {.grp = grp};
+    struct ulas_expr e = {ULAS_EXPGRP, val};
+
+    struct ulas_tok *closing = ulas_tokbufget(&ulas.toks, *i);
+    if (!closing || closing->type != ')') {
+      ULASERR("Unterminated group expression\n");
+      return -1;
+    }
+    *i += 1;
+    return ulas_exprbufpush(&ulas.exprs, e);
+  } else {
+    struct ulas_expprim prim = {*i};
+    union ulas_expval val = {.prim = prim};
+    struct ulas_expr e = {ULAS_EXPPRIM, val};
+    *i += 1;
+    return ulas_exprbufpush(&ulas.exprs, e);
+  }
+}
+
+int ulas_parsecmp(int *i);
+
+int ulas_parseun(int *i) {
+  struct ulas_tok *t = ulas_tokbufget(&ulas.toks, *i);
+
+  if (t &&
+      (t->type == '!' || t->type == '-' || t->type == '~' || t->type == '+')) {
+    int op = *i;
+    *i += 1;
+    int right = ulas_parseun(i);
+
+    struct ulas_expun un = {right, op};
+    union ulas_expval val = {.un = un};
+    struct ulas_expr e = {ULAS_EXPUN, val};
+    return ulas_exprbufpush(&ulas.exprs, e);
+  }
+
+  return ulas_parseprim(i);
+}
+
+int ulas_parsefact(int *i) {
+  int expr = ulas_parseun(i);
   struct ulas_tok *t = NULL;
 
   while ((t = ulas_tokbufget(&ulas.toks, *i)) &&
-         (t->type == ULAS_LTEQ || t->type == ULAS_GTEQ || t->type == '>' ||
-          t->type == '<')) {
+         (t->type == '*' || t->type == '/' || t->type == '%')) {
     int op = *i;
     *i += 1;
-    int right = ulas_parseshift(i);
+    int right = ulas_parseun(i);
+
+    struct ulas_expbin bin = {expr, right, op};
+    union ulas_expval val = {.bin = bin};
+    struct ulas_expr e = {ULAS_EXPBIN, val};
+    expr = ulas_exprbufpush(&ulas.exprs, e);
+  }
+
+  return expr;
+}
+
+int ulas_parseterm(int *i) {
+  int expr = ulas_parsefact(i);
+  struct ulas_tok *t = NULL;
+
+  while ((t = ulas_tokbufget(&ulas.toks, *i)) &&
+         (t->type == '+' || t->type == '-')) {
+    int op = *i;
+    *i += 1;
+    int right = ulas_parsefact(i);
+
+    struct ulas_expbin bin = {expr, right, op};
+    union ulas_expval val = {.bin = bin};
+    struct ulas_expr e = {ULAS_EXPBIN, val};
+    expr = ulas_exprbufpush(&ulas.exprs, e);
+  }
+
+  return expr;
+}
+
+int ulas_parseshift(int *i) {
+  int expr = ulas_parseterm(i);
+  struct ulas_tok *t = NULL;
+
+  while ((t = ulas_tokbufget(&ulas.toks, *i)) &&
+         (t->type == ULAS_RSHIFT || t->type == ULAS_LSHIFT)) {
+    int op = *i;
+    *i += 1;
+    int right = ulas_parseterm(i);
+
+    struct ulas_expbin bin = {expr, right, op};
+    union ulas_expval val = {.bin = bin};
+    struct ulas_expr e = {ULAS_EXPBIN, val};
+    expr = ulas_exprbufpush(&ulas.exprs, e);
+  }
+
+  return expr;
+}
+
+int ulas_parsecmp(int *i) {
+  int expr = ulas_parseshift(i);
+  struct ulas_tok *t = NULL;
+
+  while ((t = ulas_tokbufget(&ulas.toks, *i)) &&
+         (t->type == ULAS_LTEQ || t->type == ULAS_GTEQ || t->type == '>' ||
+          t->type == '<')) {
+    int op = *i;
+    *i += 1;
+    int right = ulas_parseshift(i);
+
+    struct ulas_expbin bin = {expr, right, op};
+    union ulas_expval val = {.bin = bin};
+    struct ulas_expr e = {ULAS_EXPBIN, val};
+    expr = ulas_exprbufpush(&ulas.exprs, e);
+  }
+
+  return expr;
+}
+
+int ulas_parseeq(int *i) {
+  int expr = ulas_parsecmp(i);
+  struct ulas_tok *t = NULL;
+  while ((t = ulas_tokbufget(&ulas.toks, *i)) &&
+         (t->type == ULAS_EQ || t->type == ULAS_NEQ)) {
+    int op = *i;
+    *i += 1;
+    int right = ulas_parsecmp(i);
+
+    struct ulas_expbin bin = {expr, right, op};
+    union ulas_expval val = {.bin = bin};
+    struct ulas_expr e = {ULAS_EXPBIN, val};
+    expr = ulas_exprbufpush(&ulas.exprs, e);
+  }
+
+  return expr;
+}
+
+int ulas_parsebit(int *i) {
+  int expr = ulas_parseeq(i);
+  struct ulas_tok *t = NULL;
+
+  while ((t = ulas_tokbufget(&ulas.toks, *i)) &&
+         (t->type == '&' || t->type == '|' || t->type == '^')) {
+    int op = *i;
+    *i += 1;
+    int right = ulas_parseeq(i);
+
+    struct ulas_expbin bin = {expr, right, op};
+    union ulas_expval val = {.bin = bin};
+    struct ulas_expr e = {ULAS_EXPBIN, val};
+    expr = ulas_exprbufpush(&ulas.exprs, e);
+  }
+
+  return expr;
+}
+
+int ulas_parseexprat(int *i) { return ulas_parsebit(i); }
+
+// parses tokens to expression tree
+// returns head expression index
+int ulas_parseexpr(void) {
+  ulas_exprbufclear(&ulas.exprs);
+
+  struct ulas_tokbuf *toks = &ulas.toks;
+  if (toks->len == 0) {
+    ULASERR("Expected expression\n");
+    return -1;
+  }
+
+  int i = 0;
+  int rc = ulas_parseexprat(&i);
+
+  if (i < toks->len) {
+    ULASERR("Trailing token at index %d\n", i);
+    rc = -1;
+  }
+
+  return rc;
+}
+
+int ulas_intexpreval(int i, int *rc) {
+  struct ulas_expr *e = ulas_exprbufget(&ulas.exprs, i);
+  if (!e) {
+    ULASERR("unable to evaluate expression\n");
+    *rc = -1;
+    return 0;
+  }
+
+  switch ((int)e->type) {
+  case ULAS_EXPBIN: {
+    struct ulas_tok *op = ulas_tokbufget(&ulas.toks, (int)e->val.bin.op);
+    if (!op) {
+      ULASPANIC("Binary operator was NULL\n");
+    }
+    int left = ulas_intexpreval((int)e->val.bin.left, rc);
+    int right = ulas_intexpreval((int)e->val.bin.right, rc);
+    switch ((int)op->type) {
+    case ULAS_EQ:
+      return left == right;
+    case ULAS_NEQ:
+      return left != right;
+    case '<':
+      return left < right;
+    case '>':
+      return left > right;
+    case ULAS_LTEQ:
+      return left <= right;
+    case ULAS_GTEQ:
+      return left >= right;
+    case '+':
+      return left + right;
+    case '-':
+      return left - right;
+    case '*':
+      return left * right;
+    case '/':
+      if (ulas.pass != ULAS_PASS_FINAL) {
+        return 0;
+      }
+      if (right == 0) {
+        ULASERR("integer division by 0\n");
+        *rc = -1;
+        return 0;
+      }
+      return left / right;
+    case '%':
+      if (ulas.pass != ULAS_PASS_FINAL) {
+        return 0;
+      }
+      if (right == 0) {
+        ULASERR("integer division by 0\n");
+        *rc = -1;
+        return 0;
+      }
+      return left % right;
+    case ULAS_RSHIFT:
+      return left >> right;
+    case ULAS_LSHIFT:
+      return left << right;
+    case '|':
+      return left | right;
+    case '&':
+      return left & right;
+    case '^':
+      return left ^ right;
+    default:
+      ULASPANIC("Unhandeled binary operator\n");
+      break;
+    }
+    break;
+  }
+  case ULAS_EXPUN: {
+    struct ulas_tok *op = ulas_tokbufget(&ulas.toks, (int)e->val.un.op);
+    if (!op) {
+      ULASPANIC("Unary operator was NULL\n");
+    }
+    int right = ulas_intexpreval((int)e->val.un.right, rc);
+    switch ((int)op->type) {
+    case '!':
+      return !right;
+    case '-':
+      return -right;
+    case '+':
+      return +right;
+    case '~':
+      return ~right;
+    default:
+      ULASPANIC("Unhandeled unary operation\n");
+      break;
+    }
+    break;
+  }
+  case ULAS_EXPGRP: {
+    return ulas_intexpreval((int)e->val.grp.head, rc);
+  }
+  case ULAS_EXPPRIM: {
+    struct ulas_tok *t = ulas_tokbufget(&ulas.toks, (int)e->val.prim.tok);
+    return ulas_valint(t, rc);
+  }
+  }
+
+  return 0;
+}
+
+int ulas_intexpr(const char **line, unsigned long n, int *rc) {
+  if (ulas_tokexpr(line, n) == -1) {
+    *rc = -1;
+    return -1;
+  }
+
+  int expr = ulas_parseexpr();
+  if (expr == -1) {
+    *rc = -1;
+    return -1;
+  }
+
+  // execute the tree of expressions
+  return ulas_intexpreval(expr, rc);
+}
+
+char *ulas_strexpr(const char **line, unsigned long n, int *rc) {
+  if (ulas_tokexpr(line, n) == -1) {
+    *rc = -1;
+    return NULL;
+  }
+
+  int expr = ulas_parseexpr();
+  if (expr == -1) {
+    *rc = -1;
+    return NULL;
+  }
+
+  struct ulas_expr *e = ulas_exprbufget(&ulas.exprs, expr);
+  if (!e) {
+    ULASERR("unable to evaluate expression\n");
+    *rc = -1;
+    return NULL;
+  }
+
+  switch ((int)e->type) {
+  case ULAS_EXPPRIM: {
+    struct ulas_tok *t = ulas_tokbufget(&ulas.toks, (int)e->val.prim.tok);
+    char *s = ulas_valstr(t, rc);
+    return s;
+  }
+  default:
+    ULASERR("Unhandeled string expression\n");
+    *rc = -1;
+    return NULL;
+  }
+  return NULL;
+}
+
+const char *ulas_asmregstr(unsigned int reg) {
+  if (reg >= ulas.arch.regs_len) {
+    return NULL;
+  }
+
+  return ulas.arch.regs_names[reg];
+}
+
+// tokenizes the operand list of an instruction into ulas.ops
+void ulas_asmoperands(const char *args, unsigned long n) {
+  struct ulas_opbuf *ob = &ulas.ops;
+  ulas_opbufclear(ob);
+
+  const char *line = args;
+  const char *prev = line;
+  while (ulas_tok(&ulas.tok, &line, n) > 0) {
+    if (ulas_istokend(&ulas.tok)) {
+      break;
+    }
+
+    unsigned long len = strnlen(ulas.tok.buf, ulas.tok.maxlen);
+    struct ulas_optok t;
+    memset(&t, 0, sizeof(t));
+    t.c = len == 1 ? ulas.tok.buf[0] : '\0';
+    const struct ulas_keyword *kw = ulas_arch_keyword(ulas.tok.buf, len);
+    if (kw && kw->kind == ULAS_KW_REG) {
+      t.reg = (unsigned int)kw->value;
+    }
+    t.start = prev - args;
+    t.end = line - args;
+    ulas_opbufpush(ob, t);
+    prev = line;
+  }
+
+  // same terminators as ulas_tokexpr
+  unsigned long term = ob->len;
+  for (unsigned long i = ob->len; i > 0; i--) {
+    struct ulas_optok *t = &ob->buf[i - 1];
+    if (t->c == ',' || t->c == ']' || t->c == '=') {
+      term = i - 1;
+    }
+    t->term = term;
+  }
+}
+
+#define ULAS_INSTRBUF_MIN 4
+int ulas_asminstr(char *dst, unsigned long max, const char **line,
+                  unsigned long n) {
+  const char *start = *line;
+  if (max < ULAS_INSTRBUF_MIN) {
+    ULASPANIC("Instruction buffer is too small!");
+    return -1;
+  }
+
+  // lines without symbols are encoded only once
+  const char *keyend = NULL;
+  int cacheable = ulas_linecachekey(&ulas.linecache, *line, n, &keyend);
+  if (cacheable) {
+    struct ulas_linecached *cached = ulas_linecacheget(&ulas.linecache);
+    if (cached && (cached->final || ulas.pass != ULAS_PASS_FINAL) &&
+        cached->len <= max) {
+      memcpy(dst, cached->bytes, cached->len);
+      *line = keyend;
+      return cached->len;
+    }
+  }
+  // values are only known in the final pass
+  int final = 1;
+
+  if (ulas_tok(&ulas.tok, line, n) == -1) {
+    ULASERR("Expected instruction\n");
+    return -1;
+  }
+  // only instructions with a matching name are candidates
+  unsigned long candidates_len = 0;
+  const unsigned int *candidates =
+      ulas_arch_instrs(ulas.tok.buf, strnlen(ulas.tok.buf, ulas.tok.maxlen),
+                       &candidates_len);
+
+  const char *args = *line;
+  ulas_asmoperands(args, n);
+
+  int written = 0;
+  for (unsigned long ci = 0; ci < candidates_len && written == 0; ci++) {
+    const struct ulas_instr *instr = &ulas.arch.instrs[candidates[ci]];
+
+    // first operand token and type of each expression
+    unsigned long exprat[ULAS_INSTRDATMAX];
+    short exprtype[ULAS_INSTRDATMAX];
+    int exprlen = 0;
+
+    // match the shape of the operands only
+    // expressions are not evaluated until a candidate is selected
+    const short *tok = instr->tokens;
+    unsigned long op = 0;
+    int i = 0;
+    while (tok[i]) {
+      assert(i < ULAS_INSTRTOKMAX);
+      struct ulas_optok *t = ulas_opbufget(&ulas.ops, op);
+      if (ulas_asmregstr(tok[i])) {
+        if (!t || t->reg != ulas.arch.tables->regs_canon[tok[i]]) {
+          goto skip;
+        }
+        op++;
+      } else if (tok[i] == ULAS_E8 || tok[i] == ULAS_E16 || tok[i] == ULAS_A8 ||
+                 tok[i] == ULAS_A16) {
+        // expressions span all tokens up to the next terminator
+        if (!t || t->term == op) {
+          goto skip;
+        }
+        assert(exprlen < ULAS_INSTRDATMAX);
+        exprat[exprlen] = op;
+        exprtype[exprlen++] = tok[i];
+        op = t->term;
+      } else {
+        if (!t || t->c != (char)tok[i]) {
+          goto skip;
+        }
+        op++;
+      }
+
+      i++;
+    }
+
+    // expression results in order they appear
+    // TODO: this should probably become a union of sort to allow float
+    // expressions
+    int exprres[ULAS_INSTRDATMAX];
+    int expridx = 0;
+    memset(&exprres, 0, sizeof(int) * ULAS_INSTRDATMAX);
+
+    // the size of an instruction is known from its shape alone
+    if (ULASSIZEONLY()) {
+      final = exprlen == 0;
+      exprlen = 0;
+    }
+
+    for (expridx = 0; expridx < exprlen; expridx++) {
+      const char *expr = args + ulas.ops.buf[exprat[expridx]].start;
+      int rc = 0;
+      int res = ulas_intexpr(&expr, n, &rc);
+      exprres[expridx] = res;
+      if (rc == -1) {
+        return -1;
+      }
+      cacheable = cacheable && ulas_tokbufconst(&ulas.toks);
+      final = ulas.pass == ULAS_PASS_FINAL;
+
+      if (ULASWARNLEVEL(ULAS_WARN_OVERFLOW) && (unsigned int)res > 0xFF &&
+          exprtype[expridx] == ULAS_E8) {
+        ULASWARN("Warning: 0x%X overflows the maximum allowed value of 0xFF\n",
+                 res);
+        cacheable = 0;
+      } else if (ULASWARNLEVEL(ULAS_WARN_OVERFLOW) &&
+                 (unsigned int)res > 0xFFFF && exprtype[expridx] == ULAS_E16) {
+        ULASWARN(
+            "Warning: 0x%X overflows the maximum allowed value of 0xFFFF\n",
+            res);
+        cacheable = 0;
+      }
+    }
+
+    // continue after the last matched operand token
+    *line = op > 0 ? args + ulas.ops.buf[op - 1].end : args;
+
+    // we are good to go!
+    int datread = 0;
+    expridx = 0;
+    const short *dat = instr->data;
+    while (dat[datread]) {
+      assert(datread < ULAS_INSTRDATMAX);
+      assert(expridx < ULAS_INSTRDATMAX);
+
+      if (dat[datread] == ULAS_E8 || dat[datread] == ULAS_A8) {
+        dst[written] = (char)exprres[expridx++];
+      } else if (dat[datread] == ULAS_E16 || dat[datread] == ULAS_A16) {
+        short val = (short)exprres[expridx++];
+        if (ulas.arch.endianess == ULAS_BE) {
+          dst[written++] = (char)(val >> 8);
+          dst[written] = (char)(val & 0xFF);
+        } else {
+          // write 16-bit le values
+          dst[written++] = (char)(val & 0xFF);
+          dst[written] = (char)(val >> 8);
+        }
+      } else {
+        dst[written] = (char)dat[datread];
+      }
+      written++;
+      datread++;
+    }
+
+  skip:
+    continue;
+  }
+
+  if (!written) {
+    ulas_trimend('\n', (char *)start, n);
+    ULASERR("Invalid instruction: %s\n", start);
+    return -1;
+  }
+
+  // only cache lines that were consumed entirely
+  const char *rest = *line;
+  if (cacheable && ulas_tok(&ulas.tok, &rest, n) > 0 &&
+      !ulas_istokend(&ulas.tok)) {
+    cacheable = 0;
+  }
+  if (cacheable) {
+    ulas_linecacheput(&ulas.linecache, dst, written, final);
+  }
+
+  return written;
+}
+
+void ulas_asmlst(const char *line, const char *outbuf, unsigned long n) {
+  // only record on final pass
+  // the listing is rendered after assembly
+  if (ulaslstout && ulas.pass == ULAS_PASS_FINAL) {
+    ulas_lstbufpush(&ulas.lst, line, outbuf, n);
+  }
+}
+
+// state of the ready-made sinks that write to a file
+struct ulas_sinkfile {
+  int fd;
+  // bytes written to fd so far
+  unsigned long pos;
+  // address of buf[0] for the image sink
+  unsigned int base;
+  // reference rom of the ips sink
+  const char *ref;
+  unsigned long reflen;
+};
+
+struct ulas_sinkfile *ulas_sinkfilenew(struct ulas_sink *sink, int fd) {
+  struct ulas_sinkfile *f = malloc(sizeof(struct ulas_sinkfile));
+  if (!f) {
+    ULASPANIC("%s\n", strerror(errno));
+  }
+  memset(f, 0, sizeof(struct ulas_sinkfile));
+  f->fd = fd;
+  sink->ctx = f;
+  return f;
+}
+
+// grows the sink buffer to hold at least n bytes
+// new space is zeroed
+void ulas_sinkreserve(struct ulas_sink *sink, unsigned long n) {
+  if (n <= sink->maxlen) {
+    return;
+  }
+
+  unsigned long maxlen = sink->maxlen ? sink->maxlen : ULAS_SINKBUFMAX;
+  while (maxlen < n) {
+    maxlen *= 2;
+  }
+
+  char *newbuf = realloc(sink->buf, maxlen);
+  if (!newbuf) {
+    ULASPANIC("%s\n", strerror(errno));
+  }
+  memset(newbuf + sink->maxlen, 0, maxlen - sink->maxlen);
+  sink->buf = newbuf;
+  sink->maxlen = maxlen;
+}
+
+int ulas_sinkmemwrite(struct ulas_sink *sink, unsigned int addr,
+                      const char *buf, unsigned long n) {
+  ulas_sinkreserve(sink, sink->len + n);
+  memcpy(sink->buf + sink->len, buf, n);
+  sink->len += n;
+  return 0;
+}
+
+int ulas_sinkmempatch(struct ulas_sink *sink, unsigned long offset,
+                      const char *buf, unsigned long n) {
+  if (offset + n > sink->len) {
+    return -1;
+  }
+  memcpy(sink->buf + offset, buf, n);
+  return 0;
+}
+
+int ulas_sinkmemflush(struct ulas_sink *sink) { return sink->err; }
+
+struct ulas_sink ulas_sinkmem(void) {
+  struct ulas_sink sink;
+  memset(&sink, 0, sizeof(sink));
+
+  sink.write = ulas_sinkmemwrite;
+  sink.patch = ulas_sinkmempatch;
+  sink.flush = ulas_sinkmemflush;
+
+  return sink;
+}
+
+// writes all of buf to fd
+// stdout is also used through stdio (e.g. -s - or -l -), so anything
+// buffered there is flushed first to keep the output in call order
+int ulas_fdwrite(int fd, const char *buf, unsigned long n) {
+  if (fd == fileno(stdout) && fflush(stdout) == EOF) {
+    return -1;
+  }
+
+  while (n > 0) {
+    ssize_t written = write(fd, buf, n);
+    if (written == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    buf += written;
+    n -= written;
+  }
+  return 0;
+}
+
+int ulas_sinkfdflush(struct ulas_sink *sink) {
+  struct ulas_sinkfile *f = sink->ctx;
+  if (sink->len && ulas_fdwrite(f->fd, sink->buf, sink->len) == -1) {
+    sink->err = -1;
+  }
+  sink->len = 0;
+  return sink->err;
+}
 
-    struct ulas_expbin bin = {expr, right, op};
-    union ulas_expval val = {.bin = bin};
-    struct ulas_expr e = {ULAS_EXPBIN, val};
-    expr = ulas_exprbufpush(&ulas.exprs, e);
+int ulas_sinkfdwrite(struct ulas_sink *sink, unsigned int addr,
+                     const char *buf, unsigned long n) {
+  struct ulas_sinkfile *f = sink->ctx;
+  if (sink->len + n > sink->maxlen) {
+    ulas_sinkfdflush(sink);
   }
 
-  return expr;
+  // too large for the buffer, write it directly
+  if (n > sink->maxlen) {
+    if (ulas_fdwrite(f->fd, buf, n) == -1) {
+      sink->err = -1;
+    }
+  } else {
+    memcpy(sink->buf + sink->len, buf, n);
+    sink->len += n;
+  }
+
+  f->pos += n;
+  return sink->err;
 }
 
-int ulas_parseeq(int *i) {
-  int expr = ulas_parsecmp(i);
-  struct ulas_tok *t = NULL;
-  while ((t = ulas_tokbufget(&ulas.toks, *i)) &&
-         (t->type == ULAS_EQ || t->type == ULAS_NEQ)) {
-    int op = *i;
-    *i += 1;
-    int right = ulas_parsecmp(i);
+int ulas_sinkfdpatch(struct ulas_sink *sink, unsigned long offset,
+                     const char *buf, unsigned long n) {
+  struct ulas_sinkfile *f = sink->ctx;
+  if (offset + n > f->pos || ulas_sinkfdflush(sink) == -1) {
+    return -1;
+  }
 
-    struct ulas_expbin bin = {expr, right, op};
-    union ulas_expval val = {.bin = bin};
-    struct ulas_expr e = {ULAS_EXPBIN, val};
-    expr = ulas_exprbufpush(&ulas.exprs, e);
+  if (pwrite(f->fd, buf, n, (off_t)offset) != (ssize_t)n) {
+    return -1;
   }
+  return 0;
+}
 
-  return expr;
+struct ulas_sink ulas_sinkfd(int fd) {
+  struct ulas_sink sink;
+  memset(&sink, 0, sizeof(sink));
+
+  sink.write = ulas_sinkfdwrite;
+  sink.patch = ulas_sinkfdpatch;
+  sink.flush = ulas_sinkfdflush;
+  ulas_sinkfilenew(&sink, fd);
+  ulas_sinkreserve(&sink, ULAS_SINKBUFMAX);
+
+  return sink;
 }
 
-int ulas_parsebit(int *i) {
-  int expr = ulas_parseeq(i);
-  struct ulas_tok *t = NULL;
+int ulas_sinkupdateflush(struct ulas_sink *sink) {
+  struct ulas_sinkfile *f = sink->ctx;
+  struct stat st;
+  if (sink->err == -1 || fstat(f->fd, &st) == -1) {
+    sink->err = -1;
+    return -1;
+  }
 
-  while ((t = ulas_tokbufget(&ulas.toks, *i)) &&
-         (t->type == '&' || t->type == '|' || t->type == '^')) {
-    int op = *i;
-    *i += 1;
-    int right = ulas_parseeq(i);
+  unsigned long oldlen = st.st_size;
+  const char *old = NULL;
+  if (oldlen > 0) {
+    old = mmap(NULL, oldlen, PROT_READ, MAP_SHARED, f->fd, 0);
+    if (old == MAP_FAILED) {
+      sink->err = -1;
+      return -1;
+    }
+  }
 
-    struct ulas_expbin bin = {expr, right, op};
-    union ulas_expval val = {.bin = bin};
-    struct ulas_expr e = {ULAS_EXPBIN, val};
-    expr = ulas_exprbufpush(&ulas.exprs, e);
+  for (unsigned long off = 0; off < sink->len; off += ULAS_BANKSIZE) {
+    unsigned long n = MIN(ULAS_BANKSIZE, sink->len - off);
+    unsigned long oldn = off < oldlen ? MIN(n, oldlen - off) : 0;
+    const char *b = sink->buf + off;
+    if (oldn == n && memcmp(old + off, b, n) == 0) {
+      continue;
+    }
+
+    // only rewrite the range that changed within the bank
+    unsigned long first = 0;
+    while (first < oldn && old[off + first] == b[first]) {
+      first++;
+    }
+    unsigned long last = n;
+    while (last > first && last <= oldn && old[off + last - 1] == b[last - 1]) {
+      last--;
+    }
+
+    if (pwrite(f->fd, b + first, last - first, (off_t)(off + first)) !=
+        (ssize_t)(last - first)) {
+      sink->err = -1;
+      break;
+    }
+    f->pos += last - first;
   }
 
-  return expr;
+  if (old) {
+    munmap((void *)old, oldlen);
+  }
+
+  if (sink->err != -1 && oldlen != sink->len &&
+      ftruncate(f->fd, (off_t)sink->len) == -1) {
+    sink->err = -1;
+  }
+
+  return sink->err;
 }
 
-int ulas_parseexprat(int *i) { return ulas_parsebit(i); }
+struct ulas_sink ulas_sinkupdate(int fd) {
+  struct ulas_sink sink = ulas_sinkmem();
+  sink.flush = ulas_sinkupdateflush;
+  ulas_sinkfilenew(&sink, fd);
+  return sink;
+}
 
-// parses tokens to expression tree
-// returns head expression index
-int ulas_parseexpr(void) {
-  ulas_exprbufclear(&ulas.exprs);
+unsigned long ulas_diffnext(const char *a, const char *b, unsigned long n,
+                            unsigned long i) {
+  // compare 8 bytes at a time until a word differs
+  while (i < n && n - i >= 8) {
+    uint64_t x = 0;
+    uint64_t y = 0;
+    memcpy(&x, a + i, 8);
+    memcpy(&y, b + i, 8);
+    if (x != y) {
+      break;
+    }
+    i += 8;
+  }
 
-  struct ulas_tokbuf *toks = &ulas.toks;
-  if (toks->len == 0) {
-    ULASERR("Expected expression\n");
-    return -1;
+  while (i < n && a[i] == b[i]) {
+    i++;
   }
 
-  int i = 0;
-  int rc = ulas_parseexprat(&i);
+  return i;
+}
 
-  if (i < toks->len) {
-    ULASERR("Trailing token at index %d\n", i);
-    rc = -1;
+// writes the big endian low n bytes of v
+void ulas_ipsnum(struct ulas_sink *dst, unsigned long v, int n) {
+  char buf[3];
+  for (int i = 0; i < n; i++) {
+    buf[i] = (char)((v >> ((n - 1 - i) * 8)) & 0xFF);
   }
-
-  return rc;
+  dst->write(dst, 0, buf, n);
 }
 
-int ulas_intexpreval(int i, int *rc) {
-  struct ulas_expr *e = ulas_exprbufget(&ulas.exprs, i);
-  if (!e) {
-    ULASERR("unable to evaluate expression\n");
-    *rc = -1;
-    return 0;
+int ulas_ipsdiff(struct ulas_sink *dst, const char *ref, unsigned long reflen,
+                 const char *img, unsigned long len) {
+  if (len > ULAS_IPS_OFFSETMAX + 1) {
+    ULASERR("Output is too large for an ips patch\n");
+    return -1;
   }
 
-  switch ((int)e->type) {
-  case ULAS_EXPBIN: {
-    struct ulas_tok *op = ulas_tokbufget(&ulas.toks, (int)e->val.bin.op);
-    if (!op) {
-      ULASPANIC("Binary operator was NULL\n");
-    }
-    int left = ulas_intexpreval((int)e->val.bin.left, rc);
-    int right = ulas_intexpreval((int)e->val.bin.right, rc);
-    switch ((int)op->type) {
-    case ULAS_EQ:
-      return left == right;
-    case ULAS_NEQ:
-      return left != right;
-    case '<':
-      return left < right;
-    case '>':
-      return left > right;
-    case ULAS_LTEQ:
-      return left <= right;
-    case ULAS_GTEQ:
-      return left >= right;
-    case '+':
-      return left + right;
-    case '-':
-      return left - right;
-    case '*':
-      return left * right;
-    case '/':
-      if (ulas.pass != ULAS_PASS_FINAL) {
-        return 0;
+  dst->write(dst, 0, ULAS_IPS_MAGIC, strlen(ULAS_IPS_MAGIC));
+
+  unsigned long common = MIN(len, reflen);
+  unsigned long i = 0;
+  while ((i = ulas_diffnext(ref, img, common, i)) < len) {
+    // extend the run over short equal gaps
+    unsigned long end = i + 1;
+    while (end < len) {
+      if (end >= common || ref[end] != img[end]) {
+        end++;
+        continue;
       }
-      if (right == 0) {
-        ULASERR("integer division by 0\n");
-        *rc = -1;
-        return 0;
+
+      unsigned long next = ulas_diffnext(ref, img, common, end);
+      if (next == common && common == len) {
+        break;
       }
-      return left / right;
-    case '%':
-      if (ulas.pass != ULAS_PASS_FINAL) {
-        return 0;
+      if (next - end > ULAS_IPS_GAPMAX) {
+        break;
       }
-      if (right == 0) {
-        ULASERR("integer division by 0\n");
-        *rc = -1;
-        return 0;
+      end = next;
+    }
+
+    while (i < end) {
+      // this offset would read as the end of the patch
+      if (i == ULAS_IPS_EOFOFFSET) {
+        i--;
       }
-      return left % right;
-    case ULAS_RSHIFT:
-      return left >> right;
-    case ULAS_LSHIFT:
-      return left << right;
-    case '|':
-      return left | right;
-    case '&':
-      return left & right;
-    case '^':
-      return left ^ right;
-    default:
-      ULASPANIC("Unhandeled binary operator\n");
-      break;
+
+      unsigned long n = MIN(end - i, ULAS_IPS_RECORDMAX);
+      ulas_ipsnum(dst, i, 3);
+      ulas_ipsnum(dst, n, 2);
+      dst->write(dst, 0, img + i, n);
+      i += n;
     }
-    break;
   }
-  case ULAS_EXPUN: {
-    struct ulas_tok *op = ulas_tokbufget(&ulas.toks, (int)e->val.un.op);
-    if (!op) {
-      ULASPANIC("Unary operator was NULL\n");
-    }
-    int right = ulas_intexpreval((int)e->val.un.right, rc);
-    switch ((int)op->type) {
-    case '!':
-      return !right;
-    case '-':
-      return -right;
-    case '+':
-      return +right;
-    case '~':
-      return ~right;
-    default:
-      ULASPANIC("Unhandeled unary operation\n");
-      break;
-    }
-    break;
+
+  dst->write(dst, 0, ULAS_IPS_EOF, strlen(ULAS_IPS_EOF));
+
+  // truncation extension
+  if (len < reflen) {
+    ulas_ipsnum(dst, len, 3);
   }
-  case ULAS_EXPGRP: {
-    return ulas_intexpreval((int)e->val.grp.head, rc);
+
+  return 0;
+}
+
+int ulas_sinkipsflush(struct ulas_sink *sink) {
+  struct ulas_sinkfile *f = sink->ctx;
+  // the patch is only written once
+  if (sink->err == -1 || f->pos) {
+    return sink->err;
   }
-  case ULAS_EXPPRIM: {
-    struct ulas_tok *t = ulas_tokbufget(&ulas.toks, (int)e->val.prim.tok);
-    return ulas_valint(t, rc);
+
+  struct ulas_sink patch = ulas_sinkmem();
+  if (ulas_ipsdiff(&patch, f->ref, f->reflen, sink->buf, sink->len) == -1 ||
+      ulas_fdwrite(f->fd, patch.buf, patch.len) == -1) {
+    sink->err = -1;
   }
+  f->pos = patch.len;
+  ulas_sinkfree(&patch);
+
+  return sink->err;
+}
+
+struct ulas_sink ulas_sinkips(int fd, const char *ref, unsigned long reflen) {
+  struct ulas_sink sink = ulas_sinkmem();
+  sink.flush = ulas_sinkipsflush;
+  struct ulas_sinkfile *f = ulas_sinkfilenew(&sink, fd);
+  f->ref = ref;
+  f->reflen = reflen;
+  return sink;
+}
+
+int ulas_sinkimagewrite(struct ulas_sink *sink, unsigned int addr,
+                        const char *buf, unsigned long n) {
+  struct ulas_sinkfile *f = sink->ctx;
+  if (addr < f->base) {
+    ULASERR("Address 0x%x is before the start of the image 0x%x\n", addr,
+            f->base);
+    sink->err = -1;
+    return -1;
   }
 
+  unsigned long offset = addr - f->base;
+  ulas_sinkreserve(sink, offset + n);
+  memcpy(sink->buf + offset, buf, n);
+  sink->len = MAX(sink->len, offset + n);
   return 0;
 }
 
-int ulas_intexpr(const char **line, unsigned long n, int *rc) {
-  if (ulas_tokexpr(line, n) == -1) {
-    *rc = -1;
-    return -1;
+struct ulas_sink ulas_sinkimage(unsigned int base) {
+  struct ulas_sink sink = ulas_sinkmem();
+  sink.write = ulas_sinkimagewrite;
+  // offsets are not known until all bytes are placed
+  sink.patch = NULL;
+  ulas_sinkfilenew(&sink, -1)->base = base;
+  return sink;
+}
+
+unsigned long ulas_sinkwritten(struct ulas_sink *sink) {
+  struct ulas_sinkfile *f = sink->ctx;
+  return f ? f->pos : 0;
+}
+
+void ulas_sinkfree(struct ulas_sink *sink) {
+  free(sink->buf);
+  free(sink->ctx);
+  sink->ctx = NULL;
+  sink->buf = NULL;
+  sink->len = 0;
+  sink->maxlen = 0;
+}
+
+unsigned long ulas_bytesum(const char *buf, unsigned long n) {
+  const unsigned char *b = (const unsigned char *)buf;
+  const uint64_t lo = 0x00FF00FF00FF00FFull;
+  unsigned long sum = 0;
+  unsigned long i = 0;
+
+  // sums 8 bytes at a time in four 16 bit lanes
+  // each round adds at most 2 * 255 to a lane so 128 rounds fit
+  while (n - i >= 8) {
+    uint64_t lanes = 0;
+    for (int r = 0; r < 128 && n - i >= 8; r++, i += 8) {
+      uint64_t w = 0;
+      memcpy(&w, b + i, 8);
+      lanes += (w & lo) + ((w >> 8) & lo);
+    }
+
+    for (int l = 0; l < 4; l++) {
+      sum += (lanes >> (l * 16)) & 0xFFFF;
+    }
   }
 
-  int expr = ulas_parseexpr();
-  if (expr == -1) {
-    *rc = -1;
-    return -1;
+  for (; i < n; i++) {
+    sum += b[i];
   }
 
-  // execute the tree of expressions
-  return ulas_intexpreval(expr, rc);
+  return sum;
 }
 
-char *ulas_strexpr(const char **line, unsigned long n, int *rc) {
-  if (ulas_tokexpr(line, n) == -1) {
-    *rc = -1;
-    return NULL;
+void ulas_outsum(const char *buf, unsigned long n) {
+  if (ulas.outpos < ULAS_HEADERLEN) {
+    unsigned long len = MIN(n, ULAS_HEADERLEN - ulas.outpos);
+    memcpy(ulas.header + ulas.outpos, buf, len);
   }
 
-  int expr = ulas_parseexpr();
-  if (expr == -1) {
-    *rc = -1;
-    return NULL;
-  }
+  while (n > 0) {
+    unsigned long bank = ulas.outpos / ULAS_BANKSIZE;
+    unsigned long len = MIN(n, ULAS_BANKSIZE - ulas.outpos % ULAS_BANKSIZE);
+    if (bank < ULAS_BANKSMAX) {
+      ulas.banksums[bank] += ulas_bytesum(buf, len);
+    }
 
-  struct ulas_expr *e = ulas_exprbufget(&ulas.exprs, expr);
-  if (!e) {
-    ULASERR("unable to evaluate expression\n");
-    *rc = -1;
-    return NULL;
+    ulas.outpos += len;
+    buf += len;
+    n -= len;
   }
+}
 
-  switch ((int)e->type) {
-  case ULAS_EXPPRIM: {
-    struct ulas_tok *t = ulas_tokbufget(&ulas.toks, (int)e->val.prim.tok);
-    char *s = ulas_valstr(t, rc);
-    return s;
+int ulas_chksmfix(struct ulas_sink *dst) {
+  // the sums follow the order bytes were written in, which only matches
+  // sinks that store them in that order
+  if (!dst || !dst->patch) {
+    ULASERR("Output cannot be patched with checksums\n");
+    return -1;
   }
-  default:
-    ULASERR("Unhandeled string expression\n");
-    *rc = -1;
-    return NULL;
+
+  if (ulas.outpos < ULAS_HEADERLEN) {
+    ULASERR("Output is too small to contain a header\n");
+    return -1;
   }
-  return NULL;
-}
 
-const char *ulas_asmregstr(unsigned int reg) {
-  if (reg >= ulas.arch.regs_len) {
-    return NULL;
+  if (ulas.outpos > (unsigned long)ULAS_BANKSIZE * ULAS_BANKSMAX) {
+    ULASERR("Output is too large for the global checksum\n");
+    return -1;
   }
 
-  return ulas.arch.regs_names[reg];
-}
+  unsigned char *h = (unsigned char *)ulas.header;
 
-#define ULAS_INSTRBUF_MIN 4
-int ulas_asminstr(char *dst, unsigned long max, const char **line,
-                  unsigned long n) {
-  const char *start = *line;
-  if (max < ULAS_INSTRBUF_MIN) {
-    ULASPANIC("Instruction buffer is too small!");
+  unsigned char hchksm = 0;
+  for (int i = ULAS_HEADER_START; i < ULAS_HEADER_CHKSM; i++) {
+    hchksm = (unsigned char)(hchksm - h[i] - 1);
+  }
+
+  unsigned long sum = 0;
+  for (unsigned long i = 0; i <= (ulas.outpos - 1) / ULAS_BANKSIZE; i++) {
+    sum += ulas.banksums[i];
+  }
+  // the global checksum covers the new header checksum but not itself
+  sum = sum - h[ULAS_HEADER_CHKSM] + hchksm - h[ULAS_GLOBAL_CHKSM] -
+        h[ULAS_GLOBAL_CHKSM + 1];
+
+  char patch[3] = {(char)hchksm, (char)((sum >> 8) & 0xFF),
+                   (char)(sum & 0xFF)};
+
+  if (dst->patch(dst, ULAS_HEADER_CHKSM, patch, 3) == -1) {
+    ULASERR("Unable to patch checksums: %s\n", strerror(errno));
     return -1;
   }
+  memcpy(ulas.header + ULAS_HEADER_CHKSM, patch, 3);
 
-  const struct ulas_instr *instrs = ulas.arch.instrs;
+  return 0;
+}
 
-  int written = 0;
-  while (instrs->name && written == 0) {
-    *line = start;
-    if (ulas_tok(&ulas.tok, line, n) == -1) {
-      ULASERR("Expected instruction\n");
-      return -1;
+void ulas_asmout(struct ulas_sink *dst, const char *outbuf, unsigned long n) {
+  // only write to dst on final pass
+  if (ulas.pass == ULAS_PASS_FINAL) {
+    if (dst) {
+      dst->write(dst, ulas.address, outbuf, n);
+    }
+    if (ulascfg.fix_chksm) {
+      ulas_outsum(outbuf, n);
     }
+  }
+
+  // each byte subtracts itself + 1
+  if (ulas.address < 0x14C) {
+    unsigned long sub = ulas_bytesum(outbuf, n) + n;
+    ulas.chksm = (char)((unsigned long)ulas.chksm - sub);
+  }
+}
 
-    // check for instruction name first
-    if (strncmp(ulas.tok.buf, instrs->name, ulas.tok.maxlen) != 0) {
-      goto skip;
+void ulas_asmfill(struct ulas_sink *dst, char val, unsigned long n) {
+  // only write to dst on final pass
+  if (ulas.pass == ULAS_PASS_FINAL) {
+    char buf[ULAS_FILLBUFMAX];
+    memset(buf, val, MIN(n, ULAS_FILLBUFMAX));
+
+    unsigned long left = n;
+    while (left > 0) {
+      unsigned long chunk = MIN(left, ULAS_FILLBUFMAX);
+      if (dst) {
+        dst->write(dst, ulas.address + (n - left), buf, chunk);
+      }
+      if (ulascfg.fix_chksm) {
+        ulas_outsum(buf, chunk);
+      }
+      left -= chunk;
     }
+  }
 
-    // expression results in order they appear
-    // TODO: this should probably become a union of sort to allow float
-    // expressions
-    int exprres[ULAS_INSTRDATMAX];
-    int expridx = 0;
-    memset(&exprres, 0, sizeof(int) * ULAS_INSTRDATMAX);
+  // same as n single byte writes
+  if (ulas.address < 0x14C) {
+    unsigned long sub = ((unsigned long)(unsigned char)val + 1) * n;
+    ulas.chksm = (char)((unsigned long)ulas.chksm - sub);
+  }
+}
 
-    // then check for each single token...
-    const short *tok = instrs->tokens;
-    int i = 0;
-    while (tok[i]) {
-      assert(i < ULAS_INSTRTOKMAX);
-      const char *regstr = ulas_asmregstr(tok[i]);
-      if (regstr) {
-        if (ulas_tok(&ulas.tok, line, n) == -1) {
-          goto skip;
-        }
+// skips to the next value of a comma separated list
+// returns 1 if there is a next value, 0 at the end of the line
+// and -1 if anything else follows
+int ulas_asmbulknext(const char **c, const char *end) {
+  while (*c < end && isspace(**c) && **c != '\n') {
+    *c += 1;
+  }
 
-        if (strncmp(regstr, ulas.tok.buf, ulas.tok.maxlen) != 0) {
-          goto skip;
-        }
-      } else if (tok[i] == ULAS_E8 || tok[i] == ULAS_E16 || tok[i] == ULAS_A8 ||
-                 tok[i] == ULAS_A16) {
-        assert(expridx < ULAS_INSTRDATMAX);
-        int rc = 0;
-        int res = ulas_intexpr(line, n, &rc);
-        exprres[expridx++] = res;
-        if (rc == -1) {
-          return -1;
-        }
+  if (*c < end && **c == ',') {
+    *c += 1;
+    return 1;
+  }
 
-        if (ULASWARNLEVEL(ULAS_WARN_OVERFLOW) && (unsigned int)res > 0xFF &&
-            tok[i] == ULAS_E8) {
-          ULASWARN(
-              "Warning: 0x%X overflows the maximum allowed value of 0xFF\n",
-              res);
-        } else if (ULASWARNLEVEL(ULAS_WARN_OVERFLOW) &&
-                   (unsigned int)res > 0xFFFF && tok[i] == ULAS_E16) {
-          ULASWARN(
-              "Warning: 0x%X overflows the maximum allowed value of 0xFFFF\n",
-              res);
-        }
-      } else {
-        if (ulas_tok(&ulas.tok, line, n) == -1) {
-          goto skip;
-        }
+  if (*c >= end || **c == ULAS_TOK_COMMENT || **c == '\n') {
+    return 0;
+  }
 
-        char c[2] = {(char)tok[i], '\0'};
-        if (strncmp(ulas.tok.buf, c, ulas.tok.maxlen) != 0) {
-          goto skip;
-        }
-      }
+  return -1;
+}
 
-      i++;
-    }
+long ulas_asmbulkbyte(char *dst, unsigned long max, const char **line,
+                      unsigned long n) {
+  const char *c = *line;
+  const char *end = *line + strnlen(*line, n);
+  unsigned long len = 0;
 
-    // we are good to go!
-    int datread = 0;
-    expridx = 0;
-    const short *dat = instrs->data;
-    while (dat[datread]) {
-      assert(datread < ULAS_INSTRDATMAX);
-      assert(expridx < ULAS_INSTRDATMAX);
+  int next = 1;
+  while (next == 1) {
+    while (c < end && isspace(*c)) {
+      c++;
+    }
+    if (c >= end || !isdigit(*c) || len >= max) {
+      return -1;
+    }
 
-      if (dat[datread] == ULAS_E8 || dat[datread] == ULAS_A8) {
-        dst[written] = (char)exprres[expridx++];
-      } else if (dat[datread] == ULAS_E16 || dat[datread] == ULAS_A16) {
-        short val = (short)exprres[expridx++];
-        if (ulas.arch.endianess == ULAS_BE) {
-          dst[written++] = (char)(val >> 8);
-          dst[written] = (char)(val & 0xFF);
-        } else {
-          // write 16-bit le values
-          dst[written++] = (char)(val & 0xFF);
-          dst[written] = (char)(val >> 8);
-        }
-      } else {
-        dst[written] = (char)dat[datread];
+    // same literals as ulas_totok
+    char *numend = NULL;
+    long val = 0;
+    if (c[0] == '0' && c[1] == 'b') {
+      val = strtol(c + 2, &numend, 2);
+      if (numend == c + 2) {
+        return -1;
       }
-      written++;
-      datread++;
+    } else {
+      val = strtol(c, &numend, 0);
     }
+    dst[len++] = (char)val;
+    c = numend;
 
-  skip:
-    instrs++;
+    next = ulas_asmbulknext(&c, end);
   }
 
-  if (!written) {
-    ulas_trimend('\n', (char *)start, n);
-    ULASERR("Invalid instruction: %s\n", start);
+  if (next == -1) {
     return -1;
   }
 
-  return written;
+  *line = c;
+  return (long)len;
 }
 
-void ulas_asmlst(const char *line, const char *outbuf, unsigned long n) {
-  // only write to dst on final pass
-  if (ulaslstout && ulas.pass == ULAS_PASS_FINAL) {
-    fprintf(ulaslstout, "%08X", ulas.address);
+long ulas_asmbulkstr(char *dst, unsigned long max, const char **line,
+                     unsigned long n) {
+  const char *c = *line;
+  const char *end = *line + strnlen(*line, n);
+  unsigned long len = 0;
 
-    // always pad at least n bytes
-    fputs("  ", ulaslstout);
-    const int pad = 10;
-    int outwrt = 0;
+  int next = 1;
+  while (next == 1) {
+    while (c < end && isspace(*c)) {
+      c++;
+    }
+    if (c >= end || *c != '"') {
+      return -1;
+    }
+    c++;
+
+    while (c < end && *c != '"') {
+      char b = *c++;
+      // invalid escapes are reported by the general path
+      // and a \0 ends the string there
+      if (b == '\\') {
+        int esc = c < end ? ulas_escchr(*c++) : -1;
+        if (esc == -1 || esc == '\0') {
+          return -1;
+        }
+        b = (char)esc;
+      }
 
-    for (long i = 0; i < n; i++) {
-      outwrt += fprintf(ulaslstout, "%02x ", outbuf[i] & 0xFF);
+      if (len >= max) {
+        return -1;
+      }
+      dst[len++] = ulas.charcodemap[(unsigned char)b];
     }
 
-    for (long i = outwrt; i < pad; i++) {
-      fputs(".", ulaslstout);
+    if (c >= end) {
+      return -1;
     }
+    c++;
 
-    fprintf(ulaslstout, "  (%s:%04ld) %s", ulas.filename, ulas.line, line);
+    next = ulas_asmbulknext(&c, end);
   }
-}
 
-void ulas_asmout(FILE *dst, const char *outbuf, unsigned long n) {
-  // only write to dst on final pass
-  if (ulas.pass == ULAS_PASS_FINAL) {
-    fwrite(outbuf, 1, n, dst);
+  if (next == -1) {
+    return -1;
   }
 
-  if (ulas.address < 0x14C) {
-    for (int i = 0; i < n; i++) {
-      ulas.chksm = (char)(ulas.chksm - outbuf[i] - 1);
-    }
-  }
+  *line = c;
+  return (long)len;
 }
 
-int ulas_asmdirbyte(FILE *dst, const char **line, unsigned long n, int *rc) {
+int ulas_asmdirbyte(struct ulas_sink *dst, const char **line, unsigned long n,
+                    int *rc) {
   // .db expr, expr, expr
   struct ulas_tok t;
   int written = 0;
   memset(&t, 0, sizeof(t));
 
+  // plain numbers are written in one go
+  char bulk[ULAS_LINEMAX];
+  long bulklen = ulas_asmbulkbyte(bulk, ULAS_LINEMAX, line, n);
+  if (bulklen != -1) {
+    if (!ULASSIZEONLY()) {
+      ulas_asmout(dst, bulk, bulklen);
+    }
+    return (int)bulklen;
+  }
+
   do {
-    int val = ulas_intexpr(line, n, rc);
-    char w = (char)val;
-    ulas_asmout(dst, &w, 1);
+    if (ULASSIZEONLY()) {
+      // every expression is one byte
+      if (ulas_tokexpr(line, n) == -1) {
+        *rc = -1;
+      }
+    } else {
+      int val = ulas_intexpr(line, n, rc);
+      char w = (char)val;
+      ulas_asmout(dst, &w, 1);
+    }
 
     written++;
     if (ulas_tok(&ulas.tok, line, n) > 0) {
@@ -2065,6 +3898,11 @@ int ulas_asmdirset(const char **line, unsigned long n, enum ulas_type t) {
   struct ulas_tok tok = {t, val};
 
   if (ulas.pass == ULAS_PASS_FINAL) {
+    // the token buffer owns the string
+    // but the symbol needs to outlive it
+    if (t == ULAS_STR) {
+      tok.val.strv = strdup(tok.val.strv);
+    }
     // only really define in final pass
     ulas_symbolset(name, -1, tok, 0);
   }
@@ -2081,14 +3919,16 @@ int ulas_asmdirset_lookup(const char **line, unsigned long n) {
   ulas_tok(&ulas.tok, line, n);
 
   int rc = 0;
-  struct ulas_sym *found = ulas_symbolresolve(ulas.tok.buf, -1, &rc);
+  unsigned int name = ulas_internfind(&ulas.atoms, ulas.tok.buf,
+                                      ulas.tok.maxlen);
+  long found = ulas_symbolresolve(name, -1, &rc);
 
-  if (rc == -1 || !found) {
+  if (rc == -1 || found == -1) {
     ULASERR("Unable to set symbol '%s'\n", ulas.tok.buf);
     return -1;
   }
 
-  enum ulas_type t = found->tok.type;
+  enum ulas_type t = ulas.syms.vals[found].type;
 
   *line = start;
 
@@ -2139,17 +3979,24 @@ int ulas_asmdirdefenum(const char **line, unsigned long n) {
   struct ulas_tok tok = {ULAS_INT, val};
 
   // only really define in final pass
-  ulas_symbolset(name, -1, tok, 1);
+  ulas_symbolset(name, -1, tok, ULAS_SYMF_CONSTANT);
 fail:
   return rc;
 }
 
-int ulas_asmdirfill(FILE *dst, const char **line, unsigned long n, int *rc) {
+int ulas_asmdirfill(struct ulas_sink *dst, const char **line, unsigned long n,
+                    int *rc) {
   // fill <what>, <how many>
   int written = 0;
 
-  int ival = ulas_intexpr(line, n, rc);
-  char val = (char)ival;
+  char val = 0;
+  if (ULASSIZEONLY()) {
+    if (ulas_tokexpr(line, n) == -1) {
+      *rc = -1;
+    }
+  } else {
+    val = (char)ulas_intexpr(line, n, rc);
+  }
   if (*rc == -1) {
     return 0;
   }
@@ -2174,20 +4021,120 @@ int ulas_asmdirfill(FILE *dst, const char **line, unsigned long n, int *rc) {
     return 0;
   }
 
-  for (int i = 0; i < count; i++) {
-    ulas_asmout(dst, &val, 1);
-    written++;
+  if (ULASSIZEONLY()) {
+    return count;
   }
 
+  ulas_asmfill(dst, val, count);
+  written = count;
+
   return written;
 }
 
-int ulas_asmdirstr(FILE *dst, const char **line, unsigned long n, int *rc) {
+int ulas_asmdirpad(struct ulas_sink *dst, const char **line, unsigned long n,
+                   int *rc) {
+  // pad <what>, <address>
+  char val = 0;
+  if (ULASSIZEONLY()) {
+    if (ulas_tokexpr(line, n) == -1) {
+      *rc = -1;
+    }
+  } else {
+    val = (char)ulas_intexpr(line, n, rc);
+  }
+  if (*rc == -1) {
+    return 0;
+  }
+
+  ulas_tok(&ulas.tok, line, n);
+  struct ulas_tok t =
+      ulas_totok(ulas.tok.buf, strnlen(ulas.tok.buf, ulas.tok.maxlen), rc);
+
+  if (*rc == -1 || t.type != ',') {
+    ULASERR("Expected ,\n");
+    return 0;
+  }
+
+  unsigned int addr = 0;
+  ULAS_EVALEXPRS(addr = (unsigned int)ulas_intexpr(line, n, rc));
+  if (*rc == -1) {
+    return 0;
+  }
+
+  if (addr < ulas.address) {
+    ULASERR("Pad address 0x%x is before the current address 0x%x\n", addr,
+            ulas.address);
+    *rc = -1;
+    return 0;
+  }
+
+  int count = (int)(addr - ulas.address);
+  if (!ULASSIZEONLY()) {
+    ulas_asmfill(dst, val, count);
+  }
+
+  return count;
+}
+
+int ulas_asmdiralign(struct ulas_sink *dst, const char **line, unsigned long n,
+                     int *rc) {
+  // align <n>[, <what>]
+  int align = 0;
+  ULAS_EVALEXPRS(align = ulas_intexpr(line, n, rc));
+  if (*rc == -1) {
+    return 0;
+  }
+
+  if (align <= 0) {
+    ULASERR("Alignment must be positive\n");
+    *rc = -1;
+    return 0;
+  }
+
+  char val = 0;
+  const char *prev = *line;
+  if (ulas_tok(&ulas.tok, line, n) > 0 &&
+      strncmp(ulas.tok.buf, ",", ulas.tok.maxlen) == 0) {
+    if (ULASSIZEONLY()) {
+      if (ulas_tokexpr(line, n) == -1) {
+        *rc = -1;
+      }
+    } else {
+      val = (char)ulas_intexpr(line, n, rc);
+    }
+    if (*rc == -1) {
+      return 0;
+    }
+  } else {
+    // no fill value, let the caller look at the token
+    *line = prev;
+  }
+
+  int count = (int)((align - ulas.address % align) % align);
+  if (!ULASSIZEONLY()) {
+    ulas_asmfill(dst, val, count);
+  }
+
+  return count;
+}
+
+int ulas_asmdirstr(struct ulas_sink *dst, const char **line, unsigned long n,
+                   int *rc) {
   // .str expr, expr, expr
   struct ulas_tok t;
   unsigned long written = 0;
   memset(&t, 0, sizeof(t));
 
+  // string literals are mapped and written in one go
+  char bulk[ULAS_LINEMAX];
+  long bulklen = ulas_asmbulkstr(bulk, ULAS_LINEMAX, line, n);
+  if (bulklen != -1) {
+    if (!ULASSIZEONLY()) {
+      ulas_asmout(dst, bulk, bulklen);
+    }
+    return (int)bulklen;
+  }
+
   do {
     char *s = ulas_strexpr(line, n, rc);
     if (!s || *rc != 0) {
@@ -2196,12 +4143,14 @@ int ulas_asmdirstr(FILE *dst, const char **line, unsigned long n, int *rc) {
     }
     unsigned long len = strlen(s);
 
-    // apply char code map
-    for (int i = 0; i < len; i++) {
-      s[i] = ulas.charcodemap[(int)s[i]];
-    }
+    if (!ULASSIZEONLY()) {
+      // apply char code map
+      for (int i = 0; i < len; i++) {
+        s[i] = ulas.charcodemap[(int)s[i]];
+      }
 
-    ulas_asmout(dst, s, len);
+      ulas_asmout(dst, s, len);
+    }
 
     written += len;
     if (ulas_tok(&ulas.tok, line, n) > 0) {
@@ -2214,35 +4163,86 @@ int ulas_asmdirstr(FILE *dst, const char **line, unsigned long n, int *rc) {
   return (int)written;
 }
 
-int ulas_asmdirincbin(FILE *dst, const char **line, unsigned long n, int *rc) {
+int ulas_asmdirincbin(struct ulas_sink *dst, const char **line, unsigned long n,
+                      int *rc) {
+  // incbin "path"[, offset[, length]]
   char *path = ulas_strexpr(line, n, rc);
-  char buf[256];
-  memset(buf, 0, 256);
-  unsigned long written = 0;
+  if (*rc == -1 || !path) {
+    return 0;
+  }
 
-  FILE *f = ulas_incpathfopen(path, "re");
-  if (!f) {
+  // the mapping is kept for all passes
+  const struct ulas_incbin *bin = ulas_incbinget(&ulas.incbins, path);
+  if (!bin) {
     *rc = -1;
     return 0;
   }
 
-  unsigned long read = 0;
-  while ((read = fread(buf, 1, 256, f))) {
-    ulas_asmout(dst, buf, read);
-    written += read;
+  long offset = 0;
+  long length = 0;
+  int has_length = 0;
+  for (int i = 0; i < 2; i++) {
+    const char *prev = *line;
+    if (ulas_tok(&ulas.tok, line, n) <= 0 ||
+        strncmp(ulas.tok.buf, ",", ulas.tok.maxlen) != 0) {
+      // let the caller look at the token
+      *line = prev;
+      break;
+    }
+
+    long val = 0;
+    ULAS_EVALEXPRS(val = ulas_intexpr(line, n, rc));
+    if (*rc == -1) {
+      return 0;
+    }
+    if (i == 0) {
+      offset = val;
+    } else {
+      length = val;
+      has_length = 1;
+    }
   }
 
-  fclose(f);
+  if (offset < 0 || length < 0) {
+    ULASERR("%s: negative slice %ld+%ld\n", bin->path, offset, length);
+    *rc = -1;
+    return 0;
+  }
 
-  return (int)written;
+  if (!has_length) {
+    length = (long)bin->len - offset;
+  }
+
+  if (length < 0 || offset + length > (long)bin->len) {
+    ULASERR("%s: slice %ld+%ld is out of bounds (size %ld)\n", bin->path,
+            offset, length, (long)bin->len);
+    *rc = -1;
+    return 0;
+  }
+
+  // the size is returned as an int
+  if (length > INT_MAX) {
+    ULASERR("%s: slice %ld+%ld is too large\n", bin->path, offset, length);
+    *rc = -1;
+    return 0;
+  }
+
+  // the contents are not needed for sizing
+  if (!ULASSIZEONLY() && length > 0) {
+    ulas_asmout(dst, bin->buf + offset, length);
+  }
+
+  return (int)length;
 }
 
-int ulas_asmdiradv(FILE *dst, const char **line, unsigned long n, int *rc) {
+int ulas_asmdiradv(struct ulas_sink *dst, const char **line, unsigned long n,
+                   int *rc) {
   ULAS_EVALEXPRS(ulas.address += ulas_intexpr(line, strnlen(*line, n), rc));
   return 0;
 }
 
-int ulas_asmdirsetenum(FILE *dst, const char **line, unsigned long n, int *rc) {
+int ulas_asmdirsetenum(struct ulas_sink *dst, const char **line,
+                       unsigned long n, int *rc) {
   ULAS_EVALEXPRS(ulas.enumv = ulas_intexpr(line, strnlen(*line, n), rc));
   return 0;
 }
@@ -2271,7 +4271,8 @@ int ulas_asmdirsetcharcode(const char **line, unsigned long n) {
   return rc;
 }
 
-int ulas_asmdirchr(FILE *dst, const char **line, unsigned long n, int *rc) {
+int ulas_asmdirchr(struct ulas_sink *dst, const char **line, unsigned long n,
+                   int *rc) {
   unsigned char b[2] = {0, 0};
   struct ulas_tok t;
   memset(&t, 0, sizeof(t));
@@ -2316,7 +4317,80 @@ int ulas_asmdirchr(FILE *dst, const char **line, unsigned long n, int *rc) {
   return written;
 }
 
-int ulas_asmdirrep(FILE *dst, FILE *src, const char **line, unsigned long n) {
+int ulas_asmrepcompile(struct ulas_repexpr *exprs, int *len, int max,
+                       const char *line, unsigned long n) {
+  *len = 0;
+
+  ulas_tok(&ulas.tok, &line, n);
+  const struct ulas_keyword *kw =
+      ulas_arch_keyword(ulas.tok.buf, strnlen(ulas.tok.buf, ulas.tok.maxlen));
+  if (!kw || kw->kind != ULAS_KW_ASMDIR || kw->value != ULAS_ASMDIR_BYTE) {
+    return 0;
+  }
+
+  do {
+    if (*len >= max) {
+      return 0;
+    }
+
+    if (ulas_tokexpr(&line, n) == -1) {
+      return -1;
+    }
+    int head = ulas_parseexpr();
+    if (head == -1) {
+      return -1;
+    }
+
+    // take ownership of the parsed expression
+    struct ulas_repexpr *e = &exprs[*len];
+    e->toks = ulas.toks;
+    e->exprs = ulas.exprs;
+    e->head = head;
+    *len += 1;
+    ulas.toks = ulas_tokbuf();
+    ulas.exprs = ulas_exprbuf();
+
+    if (ulas_tok(&ulas.tok, &line, n) <= 0 || ulas_istokend(&ulas.tok)) {
+      return 1;
+    }
+  } while (strncmp(ulas.tok.buf, ",", ulas.tok.maxlen) == 0);
+
+  // let the general path report trailing tokens
+  return 0;
+}
+
+// runs one iteration of a compiled .db body
+int ulas_asmrepbyte(struct ulas_sink *dst, struct ulas_repexpr *exprs, int len,
+                    const char *line) {
+  char out[ULAS_REPEXPRMAX];
+  int rc = 0;
+
+  if (!ULASSIZEONLY()) {
+    struct ulas_tokbuf toks = ulas.toks;
+    struct ulas_exprbuf eb = ulas.exprs;
+    for (int i = 0; i < len && rc != -1; i++) {
+      ulas.toks = exprs[i].toks;
+      ulas.exprs = exprs[i].exprs;
+      out[i] = (char)ulas_intexpreval(exprs[i].head, &rc);
+    }
+    ulas.toks = toks;
+    ulas.exprs = eb;
+
+    // nothing is written for a failed line
+    if (rc == -1) {
+      return -1;
+    }
+    ulas_asmout(dst, out, len);
+  }
+
+  ulas_asmlst(line, out, 0);
+  ulas.address += len;
+
+  return rc;
+}
+
+int ulas_asmdirrep(struct ulas_sink *dst, FILE *src, const char **line,
+                   unsigned long n) {
   char name[ULAS_SYMNAMEMAX];
   ulas_tok(&ulas.tok, line, n);
   if (!ulas_isname(ulas.tok.buf, ulas.tok.maxlen)) {
@@ -2332,11 +4406,6 @@ int ulas_asmdirrep(FILE *dst, FILE *src, const char **line, unsigned long n) {
     return -1;
   }
 
-  union ulas_val val = {0};
-  val.intv = 0;
-  struct ulas_tok tok = {ULAS_INT, val};
-  ulas_symbolset(name, ulas.scope, tok, 0);
-
   int repval = 0;
   int rc = 0;
 
@@ -2360,20 +4429,40 @@ int ulas_asmdirrep(FILE *dst, FILE *src, const char **line, unsigned long n) {
 
   unsigned long argline_len = strlen(*line);
 
-  for (int i = 0; i < repval; i += step) {
-    tok.val.intv = i;
-    ulas_symbolset(name, ulas.scope, tok, 0);
-    rc = ulas_asmline(dst, src, *line, argline_len);
-    if (rc == -1) {
-      break;
+  struct ulas_repexpr exprs[ULAS_REPEXPRMAX];
+  int exprs_len = 0;
+  int compiled = 0;
+  if (repval > 0) {
+    compiled = ulas_asmrepcompile(exprs, &exprs_len, ULAS_REPEXPRMAX, *line,
+                                  argline_len);
+    rc = compiled == -1 ? -1 : 0;
+  }
+
+  struct ulas_repvar var = {
+      ulas_internpush(&ulas.atoms, name, strlen(name)), 0, ulas.repvar};
+  ulas.repvar = &var;
+
+  for (int i = 0; rc != -1 && i < repval; i += step) {
+    var.val = i;
+    if (compiled) {
+      rc = ulas_asmrepbyte(dst, exprs, exprs_len, *line);
+    } else {
+      rc = ulas_asmline(dst, src, *line, argline_len);
     }
   }
 
+  ulas.repvar = var.prev;
+  for (int i = 0; i < exprs_len; i++) {
+    ulas_tokbuffree(&exprs[i].toks);
+    ulas_exprbuffree(&exprs[i].exprs);
+  }
+
   *line += argline_len;
   return rc;
 }
 
-int ulas_asmline(FILE *dst, FILE *src, const char *line, unsigned long n) {
+int ulas_asmline(struct ulas_sink *dst, FILE *src, const char *line,
+                 unsigned long n) {
   // this buffer is written both to dst and to verbose output
   char outbuf[ULAS_OUTBUFMAX];
   memset(outbuf, 0, ULAS_OUTBUFMAX);
@@ -2397,7 +4486,8 @@ int ulas_asmline(FILE *dst, FILE *src, const char *line, unsigned long n) {
   if (ulas_islabelname(ulas.tok.buf, strlen(ulas.tok.buf))) {
     instr_start = line;
     struct ulas_tok label_tok = {ULAS_INT, {(int)ulas.address}};
-    if (ulas_symbolset(ulas.tok.buf, -1, label_tok, 1) == -1) {
+    if (ulas_symbolset(ulas.tok.buf, -1, label_tok,
+                       ULAS_SYMF_CONSTANT | ULAS_SYMF_LABEL) == -1) {
       return -1;
     }
     ulas_tok(&ulas.tok, &line, n);
@@ -2409,31 +4499,11 @@ int ulas_asmline(FILE *dst, FILE *src, const char *line, unsigned long n) {
   }
 
   if (ulas.tok.buf[0] == ULAS_TOK_ASMDIR_BEGIN) {
-    const char *dirstrs[] = {ULAS_ASMSTR_ORG,          ULAS_ASMSTR_SET,
-                             ULAS_ASMSTR_BYTE,         ULAS_ASMSTR_STR,
-                             ULAS_ASMSTR_FILL,         ULAS_ASMSTR_PAD,
-                             ULAS_ASMSTR_INCBIN,       ULAS_ASMSTR_DEF,
-                             ULAS_ASMSTR_CHKSM,        ULAS_ASMSTR_ADV,
-                             ULAS_ASMSTR_SET_ENUM_DEF, ULAS_ASMSTR_DEFINE_ENUM,
-                             ULAS_ASMSTR_SETCHRCODE,   ULAS_ASMSTR_CHR,
-                             ULAS_ASMSTR_REP,          NULL};
-    enum ulas_asmdir dirs[] = {
-        ULAS_ASMDIR_ORG,          ULAS_ASMDIR_SET,
-        ULAS_ASMDIR_BYTE,         ULAS_ASMDIR_STR,
-        ULAS_ASMDIR_FILL,         ULAS_ASMDIR_PAD,
-        ULAS_ASMDIR_INCBIN,       ULAS_ASMDIR_DEF,
-        ULAS_ASMDIR_CHKSM,        ULAS_ASMDIR_ADV,
-        ULAS_ASMDIR_SET_ENUM_DEF, ULAS_ASMDIR_DEFINE_ENUM,
-        ULAS_ASMDIR_SETCHRCODE,   ULAS_ASMDIR_CHR,
-        ULAS_ASMDIR_REP};
-
     enum ulas_asmdir dir = ULAS_ASMDIR_NONE;
-
-    for (long i = 0; dirstrs[i]; i++) {
-      if (strncmp(ulas.tok.buf, dirstrs[i], n) == 0) {
-        dir = dirs[i];
-        break;
-      }
+    const struct ulas_keyword *kw = ulas_arch_keyword(
+        ulas.tok.buf, strnlen(ulas.tok.buf, ulas.tok.maxlen));
+    if (kw && kw->kind == ULAS_KW_ASMDIR) {
+      dir = (enum ulas_asmdir)kw->value;
     }
 
     if (!dir) {
@@ -2490,7 +4560,11 @@ int ulas_asmline(FILE *dst, FILE *src, const char *line, unsigned long n) {
       rc = ulas_asmdirrep(dst, src, &line, n);
       break;
     case ULAS_ASMDIR_PAD:
-      // TODO: pad is the same as .fill n, $ - n
+      other_writes += ulas_asmdirpad(dst, &line, n, &rc);
+      break;
+    case ULAS_ASMDIR_ALIGN:
+      other_writes += ulas_asmdiralign(dst, &line, n, &rc);
+      break;
     case ULAS_ASMDIR_NONE:
       ULASPANIC("asmdir not implemented\n");
       break;
@@ -2529,7 +4603,7 @@ fail:
   return rc;
 }
 
-int ulas_asmnext(FILE *dst, FILE *src, char *buf, int n) {
+int ulas_asmnext(struct ulas_sink *dst, FILE *src, char *buf, int n) {
   int rc = 1;
   if (fgets(buf, n, src) != NULL) {
     unsigned long buflen = strlen(buf);
@@ -2542,7 +4616,7 @@ int ulas_asmnext(FILE *dst, FILE *src, char *buf, int n) {
   return rc;
 }
 
-int ulas_asm(FILE *dst, FILE *src) {
+int ulas_asm(struct ulas_sink *dst, FILE *src) {
   char buf[ULAS_LINEMAX];
   memset(buf, 0, ULAS_LINEMAX);
   int rc = 0;
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 #include "archs.h"
 
 // if this is used as a path use stdin or stdout instead
@@ -13,10 +14,39 @@
 #define ULAS_CHARCODEMAPLEN 256
 
 #define ULAS_SYMNAMEMAX 256
+// name of symbols without a name in the symbol file
+#define ULAS_SYMUNNAMED "<unnamed>"
+// value of symbols whose type cannot be written
+#define ULAS_SYMUNKNOWNTYPE "<Unknown type>"
 #define ULAS_PATHMAX 4096
 #define ULAS_LINEMAX 4096
 #define ULAS_OUTBUFMAX 64
 #define ULAS_MACROPARAMMAX 15
+#define ULAS_FBUFMAX 65536
+#define ULAS_LINECACHE_KEYMAX 128
+#define ULAS_LINECACHE_BYTES 8
+#define ULAS_LINECACHEMAX 65536
+#define ULAS_REPEXPRMAX 64
+#define ULAS_FILLBUFMAX 4096
+#define ULAS_LSTBUFMAX 65536
+#define ULAS_SINKBUFMAX 65536
+
+// rom layout used by the checksum post-pass
+#define ULAS_BANKSIZE 0x4000
+#define ULAS_BANKSMAX 512
+#define ULAS_HEADER_START 0x134
+#define ULAS_HEADER_CHKSM 0x14D
+#define ULAS_GLOBAL_CHKSM 0x14E
+#define ULAS_HEADERLEN 0x150
+
+// ips patch format
+#define ULAS_IPS_MAGIC "PATCH"
+#define ULAS_IPS_EOF "EOF"
+#define ULAS_IPS_EOFOFFSET 0x454F46
+#define ULAS_IPS_OFFSETMAX 0xFFFFFF
+#define ULAS_IPS_RECORDMAX 0xFFFF
+// equal runs shorter than a record header are included in the record
+#define ULAS_IPS_GAPMAX 5
 
 #define MAX(x, y) (((x) > (y)) ? (x) : (y))
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
@@ -55,6 +85,7 @@
 #define ULAS_ASMSTR_SETCHRCODE ".scc"
 #define ULAS_ASMSTR_CHR ".chr"
 #define ULAS_ASMSTR_REP ".rep"
+#define ULAS_ASMSTR_ALIGN ".align"
 
 // configurable tokens
 #define ULAS_TOK_COMMENT ';'
@@ -80,6 +111,10 @@
   }
 #define ULASWARNLEVEL(level) (ulascfg.warn_level & (level))
 
+// passes before the final pass only need the size of each line
+// to assign addresses, expressions that do not affect the size are skipped
+#define ULASSIZEONLY() (ulas.pass != ULAS_PASS_FINAL)
+
 // format macros
 #define ULAS_FMT(f, fmt)                                                       \
   if (isatty(fileno(f)) && ulascfg.color) {                                    \
@@ -99,6 +134,34 @@
     ulas.pass = pass;                                                          \
   }
 
+/**
+ * Output sink
+ * Receives the assembled bytes of the final pass.
+ * Callers may implement their own sink and pass it in ulas_config.
+ */
+struct ulas_sink {
+  // writes n bytes that were assembled at addr
+  // returns -1 on error
+  int (*write)(struct ulas_sink *sink, unsigned int addr, const char *buf,
+               unsigned long n);
+  // overwrites n already written bytes at offset of the output
+  // NULL if the output cannot be patched
+  int (*patch)(struct ulas_sink *sink, unsigned long offset, const char *buf,
+               unsigned long n);
+  // returns -1 if any write failed
+  int (*flush)(struct ulas_sink *sink);
+
+  // output buffer of the ready-made sinks
+  int err;
+  char *buf;
+  unsigned long len;
+  unsigned long maxlen;
+
+  // private state of the sink
+  // custom sinks may use it freely
+  void *ctx;
+};
+
 /**
  * Output target files
  */
@@ -106,7 +169,10 @@
 // input file for source reader
 extern FILE *ulasin;
 // source code output target
+// used for the preprocessor and disassembler output
 extern FILE *ulasout;
+// assembled output
+extern struct ulas_sink *ulassink;
 // error output target
 extern FILE *ulaserr;
 // assembly listing output
@@ -119,7 +185,7 @@ struct ulas_tok;
 
 enum ulas_warm { ULAS_WARN_OVERFLOW = 1, ULAS_WARN_ALL = 0x7FFFFFFF };
 
-enum ulas_symfmt { ULAS_SYM_FMT_DEFAULT, ULAS_SYM_FMT_MLB };
+enum ulas_symfmt { ULAS_SYM_FMT_DEFAULT, ULAS_SYM_FMT_MLB, ULAS_SYM_FMT_BIN };
 
 struct ulas_config {
   // argv represents file names
@@ -135,6 +201,17 @@ struct ulas_config {
   int verbose;
   int preproc_only;
   int disas;
+  // assemble without writing any output
+  int check_only;
+  // patch the header and global checksum after assembly
+  int fix_chksm;
+  // only rewrite the changed ranges of an existing output file
+  int update_output;
+  // write an ips patch against this rom instead of the output
+  char *patch_ref;
+
+  // receives the assembled output instead of output_path if set
+  struct ulas_sink *sink;
 
   unsigned int org;
 
@@ -144,6 +221,11 @@ struct ulas_config {
   char **incpaths;
   unsigned int incpathslen;
 
+  // symbol files of previous builds
+  // that are loaded before the first pass
+  char **sym_imports;
+  unsigned int sym_importslen;
+
   enum ulas_warm warn_level;
 };
 
@@ -155,6 +237,18 @@ struct ulas_str {
   unsigned long maxlen;
 };
 
+/**
+ * Buffered file output
+ * Text is formatted into a large buffer
+ * that is written to dst with a single fwrite once it is full
+ */
+struct ulas_fbuf {
+  FILE *dst;
+  char *buf;
+  unsigned long len;
+  unsigned long maxlen;
+};
+
 /**
  * Tokens
  */
@@ -179,6 +273,8 @@ enum ulas_type {
 union ulas_val {
   int intv;
   char *strv;
+  // ULAS_SYMBOL tokens hold the interned name
+  unsigned int atom;
 };
 
 struct ulas_tok {
@@ -193,6 +289,28 @@ struct ulas_tokbuf {
   long maxlen;
 };
 
+// an operand token of an instruction line
+// the operands are tokenized once per line and every
+// candidate instruction is matched against these tokens
+struct ulas_optok {
+  // the token if it is a single character, otherwise 0
+  char c;
+  // register id of the token or 0
+  unsigned int reg;
+  // source offsets relative to the start of the operand list
+  unsigned long start;
+  unsigned long end;
+  // index of the token that terminates an expression starting here
+  // (',', ']', '=' or the end of the operands)
+  unsigned long term;
+};
+
+struct ulas_opbuf {
+  struct ulas_optok *buf;
+  unsigned long len;
+  unsigned long maxlen;
+};
+
 // the expression buffer hold expression buffers
 struct ulas_exprbuf {
   struct ulas_expr *buf;
@@ -200,6 +318,114 @@ struct ulas_exprbuf {
   unsigned long maxlen;
 };
 
+/**
+ * Interned strings
+ * Every identifier is mapped to a stable atom when it is tokenized
+ * which allows names to be compared with a simple integer compare.
+ * Atom 0 is never valid and denotes a missing entry.
+ */
+struct ulas_intern {
+  // atom -> string
+  char **strs;
+  unsigned long len;
+  unsigned long maxlen;
+
+  // open addressing hash table of atoms
+  unsigned int *table;
+  unsigned long tablelen;
+};
+
+/**
+ * Line cache
+ * Encoded bytes of instruction lines that do not depend on symbols
+ * or the current address, keyed by their whitespace-normalised text.
+ */
+struct ulas_linecached {
+  char bytes[ULAS_LINECACHE_BYTES];
+  unsigned char len;
+  // set if bytes is the final encoding
+  // entries from earlier passes may only be used for sizing
+  unsigned char final;
+};
+
+struct ulas_linecache {
+  // line text -> atom
+  struct ulas_intern lines;
+  // atom -> entry
+  struct ulas_linecached *entries;
+  unsigned long maxlen;
+
+  // key of the current line
+  char key[ULAS_LINECACHE_KEYMAX];
+  unsigned long keylen;
+};
+
+/**
+ * .rep
+ * The loop variable is bound outside of the symbol table
+ * so that an iteration only has to update its value.
+ * Nested loops are chained through prev.
+ */
+struct ulas_repvar {
+  unsigned int atom;
+  int val;
+  struct ulas_repvar *prev;
+};
+
+/**
+ * Listing
+ * The final pass only records each line, the text is rendered
+ * once assembly is done.
+ */
+struct ulas_lstrec {
+  unsigned int address;
+  // atom of the file name
+  unsigned int file;
+  unsigned long line;
+
+  // offsets into ulas_lstbuf.data
+  unsigned long bytes;
+  unsigned long byteslen;
+  unsigned long src;
+  unsigned long srclen;
+};
+
+struct ulas_lstbuf {
+  struct ulas_lstrec *buf;
+  unsigned long len;
+  unsigned long maxlen;
+
+  // output bytes and source text of all records
+  char *data;
+  unsigned long datalen;
+  unsigned long datamax;
+};
+
+/**
+ * Included binaries
+ * .incbin files are mapped on first use and kept for all passes.
+ * Files that cannot be mapped are read instead.
+ */
+struct ulas_incbin {
+  char *path;
+  const char *buf;
+  unsigned long len;
+  int mapped;
+};
+
+struct ulas_incbinbuf {
+  struct ulas_incbin *buf;
+  unsigned long len;
+  unsigned long maxlen;
+};
+
+// an expression of a .db body that is tokenized and parsed once
+struct ulas_repexpr {
+  struct ulas_tokbuf toks;
+  struct ulas_exprbuf exprs;
+  int head;
+};
+
 /**
  * The assembler can go over the code twice to resolve all future labels as well
  * as past labels This causes the entire process to start over for now meaning
@@ -217,22 +443,86 @@ enum ulas_pass {
  * Symbols
  */
 
-struct ulas_sym {
-  char *name;
-  struct ulas_tok tok;
-  // this label's scope index
-  int scope;
-  // last pass this was defined in...
+enum ulas_symflags {
+  ULAS_SYMF_CONSTANT = 1,
+  // set if the symbol was last defined in the resolve pass
   // a symbol may only be defined once per pass/scope
-  enum ulas_pass lastdefin;
-  int constant;
+  ULAS_SYMF_RESOLVE = 2,
+  // loaded from a previous build's symbol file
+  // imported symbols are not written to the symbol file again
+  ULAS_SYMF_IMPORTED = 4,
+  // defined by a label. only labels are in the address index
+  ULAS_SYMF_LABEL = 8,
 };
 
 // holds all currently defned symbols
+// every symbol is an index into the parallel arrays
 struct ulas_symbuf {
-  struct ulas_sym *buf;
+  // interned names
+  unsigned int *names;
+  struct ulas_tok *vals;
+  // the symbol's scope index
+  int *scopes;
+  // enum ulas_symflags
+  int *flags;
   unsigned long len;
   unsigned long maxlen;
+
+  // int labels sorted by address
+  // this is only valid after ulas_symbufsort was called
+  unsigned long *addrs;
+  unsigned long addrslen;
+};
+
+/**
+ * Binary symbol database
+ * All offsets are relative to the start of the file and all values are
+ * stored in host byte order, which allows the file to be used directly
+ * from an mmap.
+ * Layout: header, entries with labels sorted by address first, name hash
+ * table, string pool
+ */
+#define ULAS_SYMDB_MAGIC "ULSD"
+#define ULAS_SYMDB_VERSION 2
+
+struct ulas_symdb_header {
+  char magic[4];
+  uint32_t version;
+  // labels come first and are sorted by address
+  uint32_t entries_len;
+  uint32_t labels_len;
+  uint32_t entries_off;
+  // open addressing table of entry index + 1
+  // 0 marks an empty slot. the length is a power of 2
+  uint32_t hash_len;
+  uint32_t hash_off;
+  uint32_t strs_off;
+  uint32_t strs_len;
+};
+
+struct ulas_symdb_entry {
+  // offset into the string pool
+  uint32_t name;
+  // ulas_internhash of the name
+  uint32_t hash;
+  // int value or string pool offset for ULAS_STR
+  uint32_t val;
+  // enum ulas_type
+  uint16_t type;
+  // enum ulas_symflags
+  uint16_t flags;
+};
+
+// read-only view of a symbol database
+struct ulas_symdb {
+  const char *buf;
+  unsigned long len;
+  const struct ulas_symdb_header *header;
+  const struct ulas_symdb_entry *entries;
+  const uint32_t *hash;
+  const char *strs;
+  // set if buf is owned by ulas_symdbmap
+  int mapped;
 };
 
 /**
@@ -254,6 +544,7 @@ struct ulas_preproc {
 
 struct ulas {
   struct ulas_preproc pp;
+  struct ulas_intern atoms;
   char *filename;
   char *initial_filename;
   unsigned long line;
@@ -269,6 +560,16 @@ struct ulas {
   struct ulas_exprbuf exprs;
   struct ulas_symbuf syms;
 
+  // operands of the current instruction line
+  struct ulas_opbuf ops;
+  struct ulas_linecache linecache;
+
+  // innermost .rep loop variable or NULL
+  struct ulas_repvar *repvar;
+
+  struct ulas_incbinbuf incbins;
+  struct ulas_lstbuf lst;
+
   unsigned int address;
   int enumv;
 
@@ -282,6 +583,13 @@ struct ulas {
 
   char chksm;
 
+  // output offset and byte sums of each bank of the final pass
+  // only kept with -F to patch the checksums without reading
+  // the output back
+  unsigned long outpos;
+  unsigned long banksums[ULAS_BANKSMAX];
+  char header[ULAS_HEADERLEN];
+
   // character code map
   // defaults to just x=x mapping
   // but cna be set with a directive
@@ -331,7 +639,8 @@ enum ulas_ppdefs {
 
 struct ulas_ppdef {
   enum ulas_ppdefs type;
-  char *name;
+  // interned name
+  unsigned int name;
   char *value;
   int undef;
 };
@@ -398,7 +707,7 @@ enum ulas_asmdir {
   ULAS_ASMDIR_FILL,
   // .pad <expr>, <addr>
   ULAS_ASMDIR_PAD,
-  // .incbin <filename>
+  // .incbin <filename>[, <offset>[, <length>]]
   ULAS_ASMDIR_INCBIN,
   // .def name = value
   ULAS_ASMDIR_DEF,
@@ -428,6 +737,9 @@ enum ulas_asmdir {
   // .rep <n>, <step>, <line>
   // repeats a line n times
   ULAS_ASMDIR_REP,
+  // .align <n>[, <expr>]
+  // fills until the address is a multiple of n
+  ULAS_ASMDIR_ALIGN,
 };
 
 #define ULAS_INSTRTOKMAX 16
@@ -459,21 +771,50 @@ int ulas_main(struct ulas_config cfg);
 char *ulas_strndup(const char *src, unsigned long n);
 
 // resolve a symbol until an actual literal token (str, int) is found
-// returns NULL if the symbol cannot be resolved
-// returns -1 if any flagged symbol was not found
-// if flagged symbols remain unresolved (e.g. global or locals) rc is set to the
-// respective flag value
-struct ulas_sym *ulas_symbolresolve(const char *name, int scope, int *rc);
+// returns the symbol's index or -1 if the symbol cannot be resolved
+// if the symbol was not found rc is set to -1
+long ulas_symbolresolve(unsigned int name, int scope, int *rc);
+
+// finds the label with the highest address that is <= addr
+// if multiple labels share the address the first defined label is returned
+// returns the symbol's index or -1 if no such label exists
+long ulas_symbolnearest(unsigned int addr);
 
 // define a new symbol
 // scope 0 indicates global scope. a scope of -1 instructs
 // the function to auto-detect the scope
 // if a label starts with @ the current scope is used, otherwise 0 is used
+// flags are ULAS_SYMF_CONSTANT and ULAS_SYMF_LABEL
 // if the symbol already exists -1 is returned
 int ulas_symbolset(const char *cname, int scope, struct ulas_tok tok,
-                   int constant);
-
-int ulas_symbolout(FILE *dst, struct ulas_sym *s);
+                   int flags);
+
+// writes the final symbol table to dst
+// symbols are sorted by address and duplicates are removed
+int ulas_symbolout(FILE *dst);
+
+// loads all global symbols from a ulas or binary symbol file as constants
+// symbols that are already defined are skipped
+// returns -1 on error
+int ulas_symbolimport(const char *path);
+
+// 32 bit fnv-1a hash used by the intern table and the symbol database
+unsigned int ulas_internhash(const char *s, unsigned long n);
+
+// opens a symbol database stored in buf
+// buf has to outlive db
+// returns -1 if buf is not a valid database
+int ulas_symdbopen(struct ulas_symdb *db, const void *buf, unsigned long len);
+// maps the file at path and opens it
+int ulas_symdbmap(struct ulas_symdb *db, const char *path);
+void ulas_symdbclose(struct ulas_symdb *db);
+// returns the entry index of name or -1
+long ulas_symdbfind(const struct ulas_symdb *db, const char *name,
+                    unsigned long n);
+// returns the entry index of the label with the highest address <= addr
+// or -1
+long ulas_symdbnearest(const struct ulas_symdb *db, unsigned int addr);
+const char *ulas_symdbstr(const struct ulas_symdb *db, uint32_t offset);
 
 // tokenisze according to pre-defined rules
 // returns the amount of bytes of line that were
@@ -507,6 +848,21 @@ struct ulas_str ulas_strreq(struct ulas_str *s, unsigned long n);
 
 void ulas_strfree(struct ulas_str *s);
 
+// removes all trailing c from buf
+void ulas_trimend(char c, char *buf, unsigned long n);
+
+struct ulas_fbuf ulas_fbuf(FILE *dst, unsigned long maxlen);
+void ulas_fbufputs(struct ulas_fbuf *fb, const char *s, unsigned long n);
+void ulas_fbufputc(struct ulas_fbuf *fb, char c);
+// writes v as hex digits, padded with zeroes to at least width digits
+// this is the same as %x (or %X if upper is set)
+void ulas_fbufhex(struct ulas_fbuf *fb, unsigned int v, int width, int upper);
+// same as ulas_fbufhex, but decimal (%0*lu)
+void ulas_fbufdec(struct ulas_fbuf *fb, unsigned long v, int width);
+void ulas_fbufflush(struct ulas_fbuf *fb);
+// flushes and frees the buffer
+void ulas_fbuffree(struct ulas_fbuf *fb);
+
 /*
  * Preprocessor
  */
@@ -567,6 +923,16 @@ struct ulas_tok *ulas_tokbufget(struct ulas_tokbuf *tb, int i);
 void ulas_tokbufclear(struct ulas_tokbuf *tb);
 void ulas_tokbuffree(struct ulas_tokbuf *tb);
 void ulas_tokfree(struct ulas_tok *t);
+// returns 1 if the value of the tokens does not depend
+// on symbols, strings or the current address
+int ulas_tokbufconst(struct ulas_tokbuf *tb);
+
+struct ulas_opbuf ulas_opbuf(void);
+// pushes new operand token, returns newly added index
+long ulas_opbufpush(struct ulas_opbuf *ob, struct ulas_optok tok);
+struct ulas_optok *ulas_opbufget(struct ulas_opbuf *ob, unsigned long i);
+void ulas_opbufclear(struct ulas_opbuf *ob);
+void ulas_opbuffree(struct ulas_opbuf *ob);
 
 struct ulas_exprbuf ulas_exprbuf(void);
 
@@ -576,9 +942,59 @@ struct ulas_expr *ulas_exprbufget(struct ulas_exprbuf *eb, int i);
 void ulas_exprbufclear(struct ulas_exprbuf *eb);
 void ulas_exprbuffree(struct ulas_exprbuf *eb);
 
+struct ulas_intern ulas_intern(void);
+// interns n bytes of s and returns its atom
+// if the string was already interned the existing atom is returned
+unsigned int ulas_internpush(struct ulas_intern *in, const char *s,
+                             unsigned long n);
+// looks up an atom without interning it
+// returns 0 if s was never interned
+unsigned int ulas_internfind(struct ulas_intern *in, const char *s,
+                             unsigned long n);
+const char *ulas_internstr(struct ulas_intern *in, unsigned int atom);
+void ulas_internfree(struct ulas_intern *in);
+
+struct ulas_linecache ulas_linecache(void);
+// builds the key of line into lc->key
+// end is set to the end of the line's content
+// returns 0 if the line cannot be cached
+int ulas_linecachekey(struct ulas_linecache *lc, const char *line,
+                      unsigned long n, const char **end);
+// returns the entry of the current key or NULL
+struct ulas_linecached *ulas_linecacheget(struct ulas_linecache *lc);
+void ulas_linecacheput(struct ulas_linecache *lc, const char *bytes,
+                       unsigned long len, int final);
+void ulas_linecachefree(struct ulas_linecache *lc);
+
+struct ulas_lstbuf ulas_lstbuf(void);
+void ulas_lstbufpush(struct ulas_lstbuf *lb, const char *line,
+                     const char *outbuf, unsigned long n);
+// writes all records to dst and clears the buffer
+void ulas_lstrender(struct ulas_lstbuf *lb, FILE *dst);
+void ulas_lstbuffree(struct ulas_lstbuf *lb);
+
+// reads the rest of f into a new buffer
+// returns NULL on error
+char *ulas_freadall(FILE *f, unsigned long *len);
+
+// maps or reads all of f into e
+// returns -1 on error
+int ulas_incbinload(struct ulas_incbin *e, FILE *f, const char *path);
+void ulas_incbinfree(struct ulas_incbin *e);
+
+struct ulas_incbinbuf ulas_incbinbuf(void);
+// returns the mapping of path, mapping it if it was not used before
+// returns NULL on error
+const struct ulas_incbin *ulas_incbinget(struct ulas_incbinbuf *ib,
+                                         const char *path);
+void ulas_incbinbuffree(struct ulas_incbinbuf *ib);
+
 struct ulas_symbuf ulas_symbuf(void);
-int ulas_symbufpush(struct ulas_symbuf *sb, struct ulas_sym sym);
-struct ulas_sym *ulas_symbufget(struct ulas_symbuf *sb, int i);
+// pushes a new symbol, returns newly added index
+long ulas_symbufpush(struct ulas_symbuf *sb, unsigned int name,
+                     struct ulas_tok val, int scope, int flags);
+// (re-)builds the address index
+void ulas_symbufsort(struct ulas_symbuf *sb);
 void ulas_symbufclear(struct ulas_symbuf *sb);
 void ulas_symbuffree(struct ulas_symbuf *sb);
 
@@ -586,6 +1002,18 @@ void ulas_symbuffree(struct ulas_symbuf *sb);
  * Assembly step
  */
 
+// converts a line of plain number literals (.db) or string literals (.str)
+// into dst without evaluating expressions
+// line is advanced past the values on success
+// returns the amount of bytes or -1 if the line needs the general path
+long ulas_asmbulkbyte(char *dst, unsigned long max, const char **line,
+                      unsigned long n);
+long ulas_asmbulkstr(char *dst, unsigned long max, const char **line,
+                     unsigned long n);
+
+// tokenizes the operands of an instruction into ulas.ops
+void ulas_asmoperands(const char *args, unsigned long n);
+
 // assembles an instruction, writes bytes into dst
 // returns bytes written or -1 on error
 int ulas_asminstr(char *dst, unsigned long max, const char **line,
@@ -594,9 +1022,67 @@ int ulas_asminstr(char *dst, unsigned long max, const char **line,
 // returns 0 if no more data can be read
 //         > 0 if data was read
 //         -1 on error
-int ulas_asmnext(FILE *dst, FILE *src, char *buf, int n);
-int ulas_asm(FILE *dst, FILE *src);
-int ulas_asmline(FILE *dst, FILE *src, const char *line, unsigned long n);
+int ulas_asmnext(struct ulas_sink *dst, FILE *src, char *buf, int n);
+int ulas_asm(struct ulas_sink *dst, FILE *src);
+int ulas_asmline(struct ulas_sink *dst, FILE *src, const char *line,
+                 unsigned long n);
+
+// appends all bytes to a growing buffer
+struct ulas_sink ulas_sinkmem(void);
+// buffers bytes and writes them to fd
+struct ulas_sink ulas_sinkfd(int fd);
+// collects all bytes and on flush only rewrites the ranges of each bank
+// that differ from what fd already contains
+struct ulas_sink ulas_sinkupdate(int fd);
+// collects all bytes and on flush writes an ips patch
+// from ref to the collected image to fd
+struct ulas_sink ulas_sinkips(int fd, const char *ref, unsigned long reflen);
+// places bytes at their address relative to base
+// gaps are filled with 0
+// has no patch since offsets depend on every address written
+struct ulas_sink ulas_sinkimage(unsigned int base);
+// returns the bytes a ready-made sink has written to its fd so far
+unsigned long ulas_sinkwritten(struct ulas_sink *sink);
+// frees the buffer of a ready-made sink, fd is not closed
+void ulas_sinkfree(struct ulas_sink *sink);
+
+// returns the first index >= i where a and b differ or MAX(i, n)
+unsigned long ulas_diffnext(const char *a, const char *b, unsigned long n,
+                            unsigned long i);
+// writes an ips patch that turns ref into img to dst
+// returns -1 if img cannot be expressed as an ips patch
+int ulas_ipsdiff(struct ulas_sink *dst, const char *ref, unsigned long reflen,
+                 const char *img, unsigned long len);
+
+// writes n bytes of outbuf to dst
+void ulas_asmout(struct ulas_sink *dst, const char *outbuf, unsigned long n);
+// writes n copies of val to dst
+void ulas_asmfill(struct ulas_sink *dst, char val, unsigned long n);
+// .incbin "path"[, offset[, length]]
+int ulas_asmdirincbin(struct ulas_sink *dst, const char **line, unsigned long n,
+                      int *rc);
+
+// returns the sum of n bytes
+unsigned long ulas_bytesum(const char *buf, unsigned long n);
+// adds n output bytes to the bank sums of the final pass
+void ulas_outsum(const char *buf, unsigned long n);
+// patches the header and global checksum of the output in dst
+// returns -1 on error
+int ulas_chksmfix(struct ulas_sink *dst);
+
+// compiles a .rep body of the form .db expr, expr, ...
+// len is set to the amount of compiled expressions which need to be freed
+// returns 1 if the body was compiled, 0 if it has to be assembled
+// line by line or -1 on error
+int ulas_asmrepcompile(struct ulas_repexpr *exprs, int *len, int max,
+                       const char *line, unsigned long n);
+// assembles one iteration of a compiled .db body
+int ulas_asmrepbyte(struct ulas_sink *dst, struct ulas_repexpr *exprs, int len,
+                    const char *line);
+// .rep name, count, step, body
+// the loop variable is only visible to the body
+int ulas_asmdirrep(struct ulas_sink *dst, FILE *src, const char **line,
+                   unsigned long n);
 const char *ulas_asmregstr(unsigned int reg);
 
 // parses and executes a 32 bit signed int math expressions
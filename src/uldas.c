@@ -1,184 +1,534 @@
 #include "uldas.h"
+#include <errno.h>
+#include <assert.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <pthread.h>
 
 
-void ulas_dasm_print_addr(FILE *dst) {
+// address of the byte at the cursor
+// shards are decoded concurrently, so ulas.address is not used
+#define ULAS_DASM_ADDR(src) (ulascfg.org + (src)->pos)
+
+void ulas_dasm_print_addr(const struct ulas_dasmsrc *src,
+                          struct ulas_fbuf *dst) {
   if (ulascfg.print_addrs) {
-    fprintf(dst, "%08x ", ulas.address);
+    ulas_fbufhex(dst, ULAS_DASM_ADDR(src), 8, 0);
+    ulas_fbufputc(dst, ' ');
   }
 }
 
-void ulas_dasm_print_header(FILE *dst) {
+void ulas_dasm_print_header(const struct ulas_dasmsrc *src,
+                            struct ulas_fbuf *dst) {
   if (ulas.pass != ULAS_PASS_FINAL) {
     return;
   }
-  ulas_dasm_print_addr(dst);
-  fprintf(dst, ".org 0x%x\n", ulas.address);
+  ulas_dasm_print_addr(src, dst);
+  ulas_fbufputs(dst, ".org 0x", 7);
+  ulas_fbufhex(dst, ULAS_DASM_ADDR(src), 0, 0);
+  ulas_fbufputc(dst, '\n');
 }
 
-// this function assumes the bounds checks
-// for buf have already been done and will not check anymore!
-void ulas_dasm_instr_fout(FILE *src, FILE *dst, const struct ulas_instr *instr,
-                          const char *buf, unsigned long read) {
-  if (ulas.pass != ULAS_PASS_FINAL) {
-    return;
+// bitmaps hold one bit per input byte
+#define ULAS_DASM_BIT(map, i) ((map)[(i) / 8] & (1 << ((i) % 8)))
+#define ULAS_DASM_BITSET(map, i) ((map)[(i) / 8] |= (1 << ((i) % 8)))
+
+unsigned short ulas_dasm_u16(const char *buf) {
+  if (ulas.arch.endianess == ULAS_BE) {
+    return (unsigned short)((buf[1] & 0xFF) | ((buf[0] & 0xFF) << 8));
+  }
+  return (unsigned short)((buf[0] & 0xFF) | ((buf[1] & 0xFF) << 8));
+}
+
+// returns the imported symbol of the byte at offset or NULL
+const char *ulas_dasm_symbol(unsigned long offset) {
+  unsigned int addr = ulascfg.org + offset;
+  long sym = ulas_symbolnearest(addr);
+  if (sym == -1 || ulas.syms.vals[sym].val.intv != (int)addr) {
+    return NULL;
   }
 
-  ulas_dasm_print_addr(dst);
+  const char *name = ulas_internstr(&ulas.atoms, ulas.syms.names[sym]);
+  if (!name || name[0] == '\0') {
+    return NULL;
+  }
+  return name;
+}
+
+// outputs the label of the byte at offset
+// imported symbols take priority over generated labels
+// returns 0 if there is no label
+int ulas_dasm_label(const struct ulas_dasmsrc *src, struct ulas_fbuf *dst,
+                    unsigned long offset) {
+  const char *name = ulas_dasm_symbol(offset);
+  if (name) {
+    ulas_fbufputs(dst, name, strlen(name));
+    return 1;
+  }
+
+  if (ULAS_DASM_BIT(src->targets, offset)) {
+    ulas_fbufputs(dst, ULAS_DASM_LABELPREFIX,
+                  strlen(ULAS_DASM_LABELPREFIX));
+    ulas_fbufhex(dst, ulascfg.org + offset, 4, 0);
+    return 1;
+  }
+
+  return 0;
+}
+
+// returns the offset of the jump target of instr
+// or -1 if instr is not a jump into the input
+long ulas_dasm_target(const struct ulas_dasmsrc *src, unsigned int instr,
+                      const char *buf, unsigned long len) {
+  long addr = 0;
+  switch (ulas_arch_jump(instr)) {
+  case ULAS_JUMP_REL8:
+    addr = (long)ULAS_DASM_ADDR(src) + (long)len + (signed char)buf[len - 1];
+    break;
+  case ULAS_JUMP_RST:
+    addr = strtol(ulas_asmregstr(ulas.arch.instrs[instr].tokens[0]), NULL, 0);
+    break;
+  case ULAS_JUMP_ABS16: {
+    addr = ulas_dasm_u16(buf + len - 2);
+    // the upper half of the rom window is switched per bank
+    // so targets there are in the jumping instruction's bank
+    unsigned long at = ULAS_DASM_ADDR(src);
+    if (addr >= ULAS_BANKSIZE && addr < ULAS_BANKSIZE * 2 &&
+        at >= ULAS_BANKSIZE * 2) {
+      addr += (at & ~(ULAS_BANKSIZE - 1)) - ULAS_BANKSIZE;
+    }
+    break;
+  }
+  default:
+    return -1;
+  }
+
+  if (addr < (long)ulascfg.org || addr - ulascfg.org >= (long)src->len) {
+    return -1;
+  }
+  return addr - ulascfg.org;
+}
+
+void ulas_dasm_tmplputs(struct ulas_dasmtmpl *t, const char *s,
+                        unsigned long n) {
+  assert(t->len + n <= ULAS_DASM_TMPLMAX);
+  memcpy(t->text + t->len, s, n);
+  t->len += n;
+}
+
+// renders everything but the operand values of instr
+void ulas_dasm_tmpl(struct ulas_dasmtmpl *t, const struct ulas_instr *instr) {
+  memset(t, 0, sizeof(*t));
+  ulas_dasm_tmplputs(t, "  ", 2);
+  ulas_dasm_tmplputs(t, instr->name, strlen(instr->name));
+  ulas_dasm_tmplputs(t, " ", 1);
 
-  fprintf(dst, "  %s ", instr->name);
-  unsigned int bi = ulas_arch_opcode_len(buf, read);
   for (int i = 0; instr->tokens[i]; i++) {
     int dat = instr->tokens[i];
     switch (dat) {
     case ULAS_E8:
     case ULAS_A8:
-      fprintf(dst, "0x%x", buf[bi++] & 0xFF);
-      break;
     case ULAS_A16:
-    case ULAS_E16: {
-      unsigned short val = 0;
-      if (ulas.arch.endianess == ULAS_BE) {
-        val = (unsigned short)(buf[bi + 1] & 0xFF) | (unsigned short)((buf[bi] & 0xFF) << 8);
-      } else {
-        val = (unsigned short)(buf[bi] & 0xFF) | (unsigned short)((buf[bi + 1] & 0xFF) << 8);
-      }
-      bi += 2;
-      fprintf(dst, "0x%x", val & 0xFFFF);
+    case ULAS_E16:
+      t->ops[t->opslen++] = (short)dat;
+      ulas_dasm_tmplputs(t, ULAS_DASM_TMPLOP, 1);
       break;
-    }
     default: {
       const char *reg = ulas_asmregstr(dat);
       if (reg) {
-        fprintf(dst, "%s", reg);
+        ulas_dasm_tmplputs(t, reg, strlen(reg));
       } else {
-        fprintf(dst, "%c", dat);
+        char c = (char)dat;
+        ulas_dasm_tmplputs(t, &c, 1);
         // just for formatting purposes
         if (dat == ',') {
-          fprintf(dst, " ");
+          ulas_dasm_tmplputs(t, " ", 1);
         }
       }
       break;
     }
     }
   }
+}
+
+// this function assumes the bounds checks
+// for buf have already been done and will not check anymore!
+// operands that jump to a label are output as the label
+void ulas_dasm_instr_fout(const struct ulas_dasmsrc *src,
+                          struct ulas_fbuf *dst, unsigned long instr,
+                          const char *buf, unsigned long len, long target) {
+  if (ulas.pass != ULAS_PASS_FINAL) {
+    return;
+  }
+
+  // labels are only output at the start of an instruction
+  int sym = target != -1 && ULAS_DASM_BIT(src->starts, target) &&
+            (ulas_dasm_symbol(target) || ULAS_DASM_BIT(src->targets, target));
+
+  ulas_dasm_print_addr(src, dst);
+
+  const struct ulas_dasmtmpl *t = &src->tmpls[instr];
+  const char *text = t->text;
+  const char *end = t->text + t->len;
+  unsigned int bi = ulas_arch_opcode_len(buf, len);
+  for (int i = 0; i < t->opslen; i++) {
+    const char *op = memchr(text, ULAS_DASM_TMPLOP[0], end - text);
+    ulas_fbufputs(dst, text, op - text);
+    text = op + 1;
+
+    switch (t->ops[i]) {
+    case ULAS_E8:
+    case ULAS_A8:
+      if (sym) {
+        // relative to the end of the instruction
+        ulas_fbufputc(dst, '(');
+        ulas_dasm_label(src, dst, target);
+        ulas_fbufputs(dst, " - $ - ", 7);
+        ulas_fbufdec(dst, len, 0);
+        ulas_fbufputs(dst, ") & 0xff", 8);
+      } else {
+        ulas_fbufputs(dst, "0x", 2);
+        ulas_fbufhex(dst, buf[bi] & 0xFF, 0, 0);
+      }
+      bi++;
+      break;
+    default: {
+      unsigned short val = ulas_dasm_u16(buf + bi);
+      bi += 2;
+      // banked targets cannot be expressed by their label
+      if (sym && val == ulascfg.org + target) {
+        ulas_dasm_label(src, dst, target);
+      } else {
+        ulas_fbufputs(dst, "0x", 2);
+        ulas_fbufhex(dst, val, 0, 0);
+      }
+      break;
+    }
+    }
+  }
 
-  fprintf(dst, "\n");
+  ulas_fbufputs(dst, text, end - text);
+  ulas_fbufputc(dst, '\n');
+}
+
+// outputs a label if one is defined at the current address
+void ulas_dasm_label_fout(const struct ulas_dasmsrc *src,
+                          struct ulas_fbuf *dst) {
+  if (ulas.pass != ULAS_PASS_FINAL) {
+    return;
+  }
+
+  if (ulas_dasm_label(src, dst, src->pos)) {
+    ulas_fbufputs(dst, ":\n", 2);
+  }
 }
 
 // fallback if no instruction was found
-void ulas_dasm_db_fout(FILE *src, FILE *dst, const char *buf,
-                       unsigned long read) {
-  ulas.address++;
+void ulas_dasm_db_fout(const struct ulas_dasmsrc *src, struct ulas_fbuf *dst,
+                       const char *buf) {
   if (ulas.pass != ULAS_PASS_FINAL) {
     return;
   }
 
-  ulas_dasm_print_addr(dst);
-  fprintf(dst, ".db 0x%x\n", buf[0] & 0xFF);
+  ulas_dasm_print_addr(src, dst);
+  ulas_fbufputs(dst, ".db 0x", 6);
+  ulas_fbufhex(dst, buf[0] & 0xFF, 0, 0);
+  ulas_fbufputc(dst, '\n');
 }
 
-// returns > 1 if instruction was found, and 0 if not
-// the integer returned is the amount of bytes this instruction consumed
-int ulas_dasm_instr_check(FILE *src, FILE *dst, const struct ulas_instr *instr,
-                          const char *buf, unsigned long read) {
-  int i = 0;
+// returns 1 if the constant bytes of instr match buf
+// buf must hold at least the instruction's length
+int ulas_dasm_instr_check(const struct ulas_instr *instr, const char *buf) {
   int bi = 0; // current buffer index
-  // test all instruction's contents
-  for (i = 0; instr->data[i]; i++) {
+  for (int i = 0; instr->data[i]; i++) {
     unsigned int dat = instr->data[i];
     if (dat == ULAS_DATZERO) {
       dat = 0;
     }
 
-    // do we even have enough data?
-    // this is a general check for 1 byte
-    if (bi + 1 >= read) {
-      goto fail;
-    }
-
     switch (dat) {
     case ULAS_E8:
     case ULAS_A8:
-      // just ignore it
       bi++;
       break;
     case ULAS_E16:
     case ULAS_A16:
-      // need 2 bytes here
       bi += 2;
-      if (bi > read) {
-        goto fail;
-      }
       break;
     default:
       if ((buf[bi] & 0xFF) != (dat & 0xFF)) {
-        goto fail;
+        return 0;
       }
       bi++;
       break;
     }
   }
 
-  ulas_dasm_instr_fout(src, dst, instr, buf, read);
-  ulas.address += i;
-  return bi;
-fail:
+  return 1;
+}
+
+// reads all of f into src
+int ulas_dasmsrcread(struct ulas_dasmsrc *src, FILE *f) {
+  // regular files are mapped, everything else is read in one go
+  struct stat st;
+  if (fileno(f) != -1 && fstat(fileno(f), &st) != -1 &&
+      S_ISREG(st.st_mode)) {
+    if (st.st_size == 0) {
+      return 0;
+    }
+    void *buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    if (buf == MAP_FAILED) {
+      ULASERR("%s\n", strerror(errno));
+      return -1;
+    }
+    src->buf = buf;
+    src->len = st.st_size;
+    src->mapped = 1;
+    return 0;
+  }
+
+  unsigned long maxlen = ULAS_DASM_READMAX;
+  char *buf = malloc(maxlen);
+  if (!buf) {
+    ULASPANIC("%s\n", strerror(errno));
+  }
+
+  unsigned long read = 0;
+  while ((read = fread(buf + src->len, 1, maxlen - src->len, f)) > 0) {
+    src->len += read;
+    if (src->len < maxlen) {
+      continue;
+    }
+    maxlen *= 2;
+    void *newbuf = realloc(buf, maxlen);
+    if (!newbuf) {
+      ULASPANIC("%s\n", strerror(errno));
+    }
+    buf = newbuf;
+  }
+
+  if (ferror(f)) {
+    ULASERR("%s\n", strerror(errno));
+    free(buf);
+    src->len = 0;
+    return -1;
+  }
+
+  src->buf = buf;
   return 0;
 }
 
-#define ULAS_DASM_BUFMAX 4
+int ulas_dasmsrc(struct ulas_dasmsrc *src, FILE *f) {
+  memset(src, 0, sizeof(*src));
+  if (ulas_dasmsrcread(src, f) == -1) {
+    return -1;
+  }
+
+  unsigned long n = src->len / 8 + 1;
+  src->starts = calloc(n, 1);
+  src->targets = calloc(n, 1);
+
+  unsigned long instrs = 0;
+  while (ulas.arch.instrs[instrs].name) {
+    instrs++;
+  }
+  src->tmpls = malloc(instrs * sizeof(struct ulas_dasmtmpl));
+  if (!src->starts || !src->targets || !src->tmpls) {
+    ULASPANIC("%s\n", strerror(errno));
+  }
+  for (unsigned long i = 0; i < instrs; i++) {
+    ulas_dasm_tmpl(&src->tmpls[i], &ulas.arch.instrs[i]);
+  }
+
+  return 0;
+}
+
+void ulas_dasmsrcfree(struct ulas_dasmsrc *src) {
+  free(src->starts);
+  free(src->targets);
+  free(src->tmpls);
+  if (src->mapped) {
+    munmap((void *)src->buf, src->len);
+  } else {
+    free((void *)src->buf);
+  }
+  memset(src, 0, sizeof(*src));
+}
 
 // dasm the next instruction
-// if there are no more bytes to be read, return 0
+// if the end of the shard is reached, return 0
 // on error return -1
 // otherwise return 1
-int ulas_dasm_next(FILE *src, FILE *dst) {
-  long srctell = ftell(src);
-  // read n bytes (as many as in instruction)
-  char buf[ULAS_DASM_BUFMAX];
-  memset(buf, 0, ULAS_DASM_BUFMAX);
-  unsigned long read = 0;
-
-  // find the correct instructions
-  // needs to match every byte!
-  // first read max outbuf
-  read = fread(buf, 1, ULAS_DASM_BUFMAX, src);
-  if (read == 0) {
+int ulas_dasm_next(struct ulas_dasmsrc *src, struct ulas_fbuf *dst) {
+  if (src->pos >= src->end) {
     return 0;
   }
 
-  // now find the instruction that matches all
-  // read bytes
-  // -> then reset src's read buffer to the srctell + actual instruction's
-  // length if nothing matches simply output a .db for the first byte and return
-  for (int i = 0; ulas.arch.instrs[i].name; i++) {
-    const struct ulas_instr *instr = &ulas.arch.instrs[i];
+  // instructions may run past the end of the shard
+  const char *buf = src->buf + src->pos;
+  unsigned long read = src->len - src->pos;
 
-    int consumed = ulas_dasm_instr_check(src, dst, instr, buf, read);
-    if (consumed) {
-      fseek(src, srctell + consumed, 0);
-      return 1;
+  ulas_dasm_label_fout(src, dst);
+  if (ulas.pass != ULAS_PASS_FINAL) {
+    ULAS_DASM_BITSET(src->starts, src->pos);
+  }
+
+  // the opcode decides the instruction
+  // if nothing matches simply output a .db for the first byte
+  const struct ulas_instrrange *d = ulas_arch_decode(buf, read);
+  if (d && ulas_dasm_instr_check(&ulas.arch.instrs[d->start], buf)) {
+    long target = ulas_dasm_target(src, d->start, buf, d->len);
+    if (ulas.pass != ULAS_PASS_FINAL && target != -1) {
+      ULAS_DASM_BITSET(src->targets, target);
     }
+
+    ulas_dasm_instr_fout(src, dst, d->start, buf, d->len, target);
+    src->pos += d->len;
+    return 1;
   }
 
-  ulas_dasm_db_fout(src, dst, buf, read);
-  fseek(src, srctell + 1, 0);
+  ulas_dasm_db_fout(src, dst, buf);
+  src->pos++;
   return 1;
 }
 
-// TODO: implement label generation
-int ulas_dasm(FILE *src, FILE *dst) {
-  // pass 1: run and collect labels
-  // pass 2: run and output to file
+int ulas_dasm_range(struct ulas_dasmsrc *src, struct ulas_fbuf *dst) {
+  int rc = 0;
+  do {
+    rc = ulas_dasm_next(src, dst);
+  } while (rc > 0);
+  return rc;
+}
+
+// returns the first instruction start at or after offset
+unsigned long ulas_dasm_nextstart(const struct ulas_dasmsrc *src,
+                                  unsigned long offset) {
+  while (offset < src->len && !ULAS_DASM_BIT(src->starts, offset)) {
+    offset++;
+  }
+  return offset < src->len ? offset : src->len;
+}
+
+struct ulas_dasmshard {
+  struct ulas_dasmsrc src;
+  char *out;
+  size_t outlen;
+  int rc;
+};
+
+struct ulas_dasmworker {
+  struct ulas_dasmshard *shards;
+  unsigned long len;
+  unsigned long first;
+  unsigned long stride;
+};
+
+void *ulas_dasm_work(void *arg) {
+  struct ulas_dasmworker *w = arg;
+  for (unsigned long i = w->first; i < w->len; i += w->stride) {
+    struct ulas_dasmshard *shard = &w->shards[i];
+    FILE *f = open_memstream(&shard->out, &shard->outlen);
+    if (!f) {
+      shard->rc = -1;
+      continue;
+    }
+    struct ulas_fbuf fb = ulas_fbuf(f, ULAS_DASM_OUTBUFMAX);
+    shard->rc = ulas_dasm_range(&shard->src, &fb);
+    ulas_fbuffree(&fb);
+    fclose(f);
+  }
+  return NULL;
+}
+
+int ulas_dasm_banks(struct ulas_dasmsrc *src, struct ulas_fbuf *dst,
+                    unsigned long threads) {
+  unsigned long banks = (src->len + ULAS_BANKSIZE - 1) / ULAS_BANKSIZE;
+  if (threads > banks) {
+    threads = banks;
+  }
+
+  // each shard starts at the first instruction of its bank
+  // so the output is the same as decoding in one go
+  struct ulas_dasmshard *shards = calloc(banks, sizeof(*shards));
+  struct ulas_dasmworker *workers = calloc(threads, sizeof(*workers));
+  pthread_t *tids = calloc(threads, sizeof(pthread_t));
+  if (!shards || !workers || !tids) {
+    ULASPANIC("%s\n", strerror(errno));
+  }
+
+  unsigned long start = 0;
+  for (unsigned long i = 0; i < banks; i++) {
+    shards[i].src = *src;
+    shards[i].src.pos = start;
+    start = ulas_dasm_nextstart(src, (i + 1) * ULAS_BANKSIZE);
+    shards[i].src.end = start;
+  }
 
-  ulas_dasm_print_header(dst);
+  // the calling thread is the first worker
+  for (unsigned long i = 0; i < threads; i++) {
+    workers[i] = (struct ulas_dasmworker){shards, banks, i, threads};
+    if (i > 0 &&
+        pthread_create(&tids[i], NULL, ulas_dasm_work, &workers[i]) != 0) {
+      ulas_dasm_work(&workers[i]);
+      workers[i].len = 0;
+    }
+  }
+  ulas_dasm_work(&workers[0]);
 
   int rc = 0;
-  while ((rc = ulas_dasm_next(src, dst)) > 0) {
-    if (rc == -1) {
-      return -1;
+  for (unsigned long i = 1; i < threads; i++) {
+    if (workers[i].len) {
+      pthread_join(tids[i], NULL);
     }
   }
 
+  for (unsigned long i = 0; i < banks; i++) {
+    if (shards[i].rc == -1) {
+      rc = -1;
+    } else {
+      ulas_fbufputs(dst, shards[i].out, shards[i].outlen);
+    }
+    free(shards[i].out);
+  }
+
+  free(tids);
+  free(workers);
+  free(shards);
+  src->pos = src->len;
+  return rc;
+}
+
+unsigned long ulas_dasm_threads(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n < 1) {
+    return 1;
+  }
+  return n > ULAS_DASM_THREADSMAX ? ULAS_DASM_THREADSMAX : n;
+}
+
+// the first pass collects instruction starts and jump targets
+// the final pass outputs the code with a label at each target
+// once the starts are known the banks are output in parallel
+// lines are rendered into a buffer that is written once it is full
+int ulas_dasm(struct ulas_dasmsrc *src, FILE *dst) {
+  ulas.address = ulascfg.org;
+  src->pos = 0;
+  src->end = src->len;
+  struct ulas_fbuf fb = ulas_fbuf(dst, ULAS_DASM_OUTBUFMAX);
+  ulas_dasm_print_header(src, &fb);
+
+  int rc = 0;
+  unsigned long threads = ulas_dasm_threads();
+  if (ulas.pass == ULAS_PASS_FINAL && src->scanned && threads > 1 &&
+      src->len > ULAS_BANKSIZE) {
+    rc = ulas_dasm_banks(src, &fb, threads);
+  } else {
+    rc = ulas_dasm_range(src, &fb);
+  }
+
+  ulas_fbuffree(&fb);
+  src->scanned = 1;
+  ulas.address = ulascfg.org + src->len;
   return rc;
 }
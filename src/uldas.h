@@ -7,7 +7,63 @@
 #include "ulas.h"
 #include "archs.h"
 
-// Disassemble a file based on the current arch
-int ulas_dasm(FILE *src, FILE *dst);
+#define ULAS_DASM_READMAX 4096
+#define ULAS_DASM_LABELMAX 32
+#define ULAS_DASM_LABELPREFIX "L_"
+#define ULAS_DASM_THREADSMAX 64
+#define ULAS_DASM_OUTBUFMAX 65536
+#define ULAS_DASM_TMPLMAX 32
+// marks an operand value in a template
+#define ULAS_DASM_TMPLOP "\x01"
+
+/**
+ * Output template of an instruction
+ * The text has everything but the operand values, which are
+ * inserted at each ULAS_DASM_TMPLOP in order of ops.
+ */
+struct ulas_dasmtmpl {
+  char text[ULAS_DASM_TMPLMAX];
+  unsigned char len;
+  unsigned char opslen;
+  short ops[ULAS_INSTRTOKMAX];
+};
+
+/**
+ * Disassembler input
+ * The whole input is mapped (or read if it cannot be mapped)
+ * once and then decoded from memory with a cursor.
+ * The bitmaps are filled by the first pass and have one bit per byte.
+ */
+struct ulas_dasmsrc {
+  const char *buf;
+  unsigned long len;
+  unsigned long pos;
+  // end of the shard that is being decoded
+  unsigned long end;
+  int mapped;
+  // set once the bitmaps are filled
+  int scanned;
+  // bytes that start an instruction
+  unsigned char *starts;
+  // bytes that are jumped to
+  unsigned char *targets;
+  // one template per instruction of the arch
+  struct ulas_dasmtmpl *tmpls;
+};
+
+int ulas_dasmsrc(struct ulas_dasmsrc *src, FILE *f);
+void ulas_dasmsrcfree(struct ulas_dasmsrc *src);
+
+// Disassemble src based on the current arch
+int ulas_dasm(struct ulas_dasmsrc *src, FILE *dst);
+
+// Disassemble from pos to end of src
+int ulas_dasm_range(struct ulas_dasmsrc *src, struct ulas_fbuf *dst);
+
+// Disassemble one shard per bank on up to threads threads
+// and output the shards in order
+// requires the bitmaps of a previous pass
+int ulas_dasm_banks(struct ulas_dasmsrc *src, struct ulas_fbuf *dst,
+                    unsigned long threads);
 
 #endif
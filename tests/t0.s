@@ -160,3 +160,6 @@ toplevel 5, 6
 :
   halt
 
+.align 8
+.pad 0, $ + 2
+.incbin "tests/inc.bin", 1, 2
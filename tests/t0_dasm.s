@@ -1,21 +1,26 @@
 .org 0x0
+L_0000:
   nop 
   halt 
+L_0002:
   stop 
   di 
+L_0005:
   ei 
   ld c, a
   ld b, [hl]
   adc a, c
   ld b, 0x8
-  jr nz, 0x4
+  jr nz, (L_0011 - $ - 2) & 0xff
   ld sp, 0x31a
   ld [hl+], a
+L_0011:
   inc hl
   inc [hl]
   ld [hl], 0x1
   ld [0x3], sp
-  jr 0xfe
+L_0018:
+  jr (L_0018 - $ - 2) & 0xff
   add hl, bc
   ld a, [bc]
   ld a, [hl+]
@@ -30,9 +35,9 @@
   ld [0x1], a
   ld a, [0x2]
   pop bc
-  jp nz, 0x2
+  jp nz, L_0002
   jp 0x3
-  call nc, 0x2
+  call nc, L_0002
   push af
   add a, 0x3
   rst 0x00
@@ -40,14 +45,12 @@
   ld hl, sp+0x2
   ret 
   reti 
-  jp z, 0x2
-  call 0x5
-  rlc b
-  ld bc, 0x6cb
-  rlc b
-  ld b, d
-  rlc b
-  ld b, [hl]
+  jp z, L_0002
+  call L_0005
+  rlc c
+  rlc [hl]
+  bit 0, d
+  bit 0, [hl]
   ld bc, 0x14d
   ld bc, 0x153
   ld bc, 0x156
@@ -76,7 +79,7 @@
   ld [hl-], a
   xor a, d
   cp a, e
-  call z, 0xdd
+  call z, L_00dd
   halt 
   nop 
   jp 0x195
@@ -119,5 +122,16 @@
 .db 0x74
   dec b
   inc b
-.db 0x6
-.db 0x76
+  ld b, 0x76
+  nop 
+  nop 
+  nop 
+  nop 
+  nop 
+L_00dd:
+  nop 
+  nop 
+  nop 
+  nop 
+  cp a, e
+.db 0xcc